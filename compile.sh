@@ -1 +1,16 @@
-g++ main.cpp -o test -Iinclude -lwiringPi -lrt -lpthread -Wall `pkg-config --cflags --libs opencv4.pc`
+# Pipeline library, everything in include/, for main and the tools to link against
+mkdir -p build && (cd build && g++ -O2 -c ../include/*.cpp -I../include -Wall `pkg-config --cflags opencv4.pc`) && ar rcs libbairhockey.a build/*.o
+g++ -O2 main.cpp libbairhockey.a -o test -Iinclude -lwiringPi -lrt -lpthread -Wall `pkg-config --cflags --libs opencv4.pc`
+
+g++ tools/latency_report.cpp include/Latency.cpp -o latency_report -Iinclude -lwiringPi -lrt -lpthread -Wall `pkg-config --cflags --libs opencv4.pc`
+g++ -O2 sim/table_sim.cpp sim/TableSim.cpp libbairhockey.a -o table_sim -Iinclude -Isim -lpthread -Wall `pkg-config --cflags --libs opencv4.pc`
+g++ -O2 sim/render_bench.cpp sim/Renderer.cpp sim/TableSim.cpp libbairhockey.a -o render_bench -Iinclude -Isim -lpthread -Wall `pkg-config --cflags --libs opencv4.pc`
+gcc -O2 psoc_code/host_sim/fw_sim.c psoc_code/host_sim/firmware_main.c psoc_code/host_sim/stubs.c psoc_code/135_motor_project.cydsn/stepper.c psoc_code/135_motor_project.cydsn/planner.c psoc_code/135_motor_project.cydsn/params.c psoc_code/135_motor_project.cydsn/profile.c psoc_code/135_motor_project.cydsn/homing.c -o fw_sim -Ipsoc_code/host_sim -Ipsoc_code/135_motor_project.cydsn -lm -Wall
+gcc -O2 psoc_code/host_sim/planner_test.c psoc_code/135_motor_project.cydsn/planner.c -o planner_test -Ipsoc_code/host_sim -Ipsoc_code/135_motor_project.cydsn -lm -Wall
+gcc -O2 psoc_code/host_sim/mailbox_test.c -o mailbox_test -Ipsoc_code/135_motor_project.cydsn -lpthread -lrt -Wall
+g++ -O2 tools/jitter_bench.cpp libbairhockey.a -o jitter_bench -Iinclude -lpthread -Wall
+g++ -O2 tools/rt_fault_test.cpp libbairhockey.a -o rt_fault_test -Iinclude -lpthread -Wall
+g++ -O2 tools/replay.cpp libbairhockey.a -o replay -Iinclude -lrt -lpthread -Wall `pkg-config --cflags --libs opencv4.pc`
+g++ -O2 tools/vision_bench.cpp sim/Renderer.cpp libbairhockey.a -o vision_bench -Iinclude -Isim -lpthread -Wall `pkg-config --cflags --libs opencv4.pc`
+g++ -O2 tools/annotate.cpp libbairhockey.a -o annotate -Iinclude -lrt -lpthread -Wall `pkg-config --cflags --libs opencv4.pc`
+g++ -O2 tools/accuracy_bench.cpp libbairhockey.a -o accuracy_bench -Iinclude -lrt -lpthread -Wall `pkg-config --cflags --libs opencv4.pc`
@@ -0,0 +1,117 @@
+#include <AllocTrack.h>
+
+#include <errno.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+// glibc's own allocator entry points, which the interposers below forward to
+extern "C"
+{
+    void *__libc_malloc(size_t size);
+    void *__libc_calloc(size_t n, size_t size);
+    void *__libc_realloc(void *ptr, size_t size);
+    void *__libc_memalign(size_t alignment, size_t size);
+    void *__libc_valloc(size_t size);
+    void *__libc_pvalloc(size_t size);
+    void __libc_free(void *ptr);
+}
+
+// Plain thread locals, no constructors, so they are safe before main() and inside malloc
+static __thread bool tracking = false;
+static __thread bool strict_mode = false;
+static __thread long allocations = 0;
+
+static inline void counted()
+{
+    if (!tracking)
+    {
+        return;
+    }
+    allocations++;
+    if (strict_mode)
+    {
+        static const char msg[] = "AllocTrack: heap allocation in a tracked section\n";
+        write(STDERR_FILENO, msg, sizeof(msg) - 1); // printf could allocate
+        abort();
+    }
+}
+
+void allocTrackBegin(bool strict)
+{
+    allocations = 0;
+    strict_mode = strict;
+    tracking = true;
+}
+
+long allocTrackEnd()
+{
+    tracking = false;
+    return allocations;
+}
+
+extern "C"
+{
+    void *malloc(size_t size)
+    {
+        counted();
+        return __libc_malloc(size);
+    }
+
+    void *calloc(size_t n, size_t size)
+    {
+        counted();
+        return __libc_calloc(n, size);
+    }
+
+    void *realloc(void *ptr, size_t size)
+    {
+        counted();
+        return __libc_realloc(ptr, size);
+    }
+
+    void free(void *ptr)
+    {
+        __libc_free(ptr);
+    }
+
+    void *memalign(size_t alignment, size_t size)
+    {
+        counted();
+        return __libc_memalign(alignment, size);
+    }
+
+    void *aligned_alloc(size_t alignment, size_t size)
+    {
+        counted();
+        return __libc_memalign(alignment, size);
+    }
+
+    int posix_memalign(void **ptr, size_t alignment, size_t size)
+    {
+        // A power of two multiple of sizeof(void *), as glibc checks
+        if (alignment % sizeof(void *) != 0 || (alignment & (alignment - 1)) != 0 || alignment == 0)
+        {
+            return EINVAL;
+        }
+        counted();
+        void *p = __libc_memalign(alignment, size);
+        if (p == NULL)
+        {
+            return ENOMEM;
+        }
+        *ptr = p;
+        return 0;
+    }
+
+    void *valloc(size_t size)
+    {
+        counted();
+        return __libc_valloc(size);
+    }
+
+    void *pvalloc(size_t size)
+    {
+        counted();
+        return __libc_pvalloc(size);
+    }
+}
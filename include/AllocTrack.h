@@ -0,0 +1,20 @@
+#ifndef ALLOCTRACK_INCLUDED
+#define ALLOCTRACK_INCLUDED
+
+/* Counts the heap allocations a thread makes between allocTrackBegin() and
+   allocTrackEnd(). Linking AllocTrack.cpp interposes malloc and friends for
+   the whole process, OpenCV and operator new included, at the cost of a
+   thread local check per call. In strict mode an allocation while tracking
+   aborts, so a core dump or gdb shows where it came from.
+
+   Only the calling thread is counted. Allocations OpenCV makes in its
+   parallel_for_ worker threads (warpPerspective, medianBlur and the like
+   split their work across them) are not seen, so a count of zero says
+   nothing about those threads. */
+
+void allocTrackBegin(bool strict = false);
+
+// Stops tracking and returns the allocations since allocTrackBegin()
+long allocTrackEnd();
+
+#endif
@@ -0,0 +1,57 @@
+#include <Annotations.h>
+
+#include <stdio.h>
+#include <string.h>
+
+bool loadAnnotations(const char *path, std::vector<Annotation> &out)
+{
+    FILE *f = fopen(path, "r");
+    if (f == NULL)
+    {
+        return false;
+    }
+
+    char line[128], word[16];
+    while (fgets(line, sizeof(line), f) != NULL)
+    {
+        Annotation a;
+        if (line[0] == '#')
+        {
+            continue;
+        }
+        if (sscanf(line, "%ld %f %f", &a.record, &a.centre.x, &a.centre.y) == 3)
+        {
+            a.puck = true;
+        }
+        else if (sscanf(line, "%ld %15s", &a.record, word) == 2 && strcmp(word, "none") == 0)
+        {
+            a.puck = false;
+        }
+        else
+        {
+            continue; // Blank line
+        }
+        out.push_back(a);
+    }
+    fclose(f);
+    return true;
+}
+
+bool saveAnnotations(const char *path, const std::vector<Annotation> &annotations)
+{
+    FILE *f = fopen(path, "w");
+    if (f == NULL)
+    {
+        return false;
+    }
+
+    fprintf(f, "# Puck centres in the corrected table, written by annotate\n");
+    for (const Annotation &a : annotations)
+    {
+        if (a.puck)
+            fprintf(f, "%ld %.2f %.2f\n", a.record, a.centre.x, a.centre.y);
+        else
+            fprintf(f, "%ld none\n", a.record);
+    }
+    return fclose(f) == 0;
+}
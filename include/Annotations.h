@@ -0,0 +1,26 @@
+#ifndef ANNOTATIONS_INCLUDED
+#define ANNOTATIONS_INCLUDED
+
+#include <opencv2/opencv.hpp>
+#include <vector>
+
+#define ANNOTATIONS_EXT ".truth" // Next to the session log, run.bhr.truth
+
+/* Hand marked puck centres for recorded frames, made with tools/annotate
+   and scored against by tools/accuracy_bench. One line per frame:
+       record x y    puck centre in the corrected table [px]
+       record none   no puck in view
+   Lines starting with # are comments. */
+struct Annotation
+{
+    long record; // Index in the session log
+    bool puck;   // False if there is no puck in view
+    cv::Point2f centre;
+};
+
+// Adds the file's annotations to out. Returns false if it could not be opened.
+bool loadAnnotations(const char *path, std::vector<Annotation> &out);
+
+bool saveAnnotations(const char *path, const std::vector<Annotation> &annotations);
+
+#endif
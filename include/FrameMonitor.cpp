@@ -0,0 +1,91 @@
+#include <FrameMonitor.h>
+
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+
+using namespace std;
+using namespace cv;
+
+// Same clock as the V4L2 buffer timestamps [ms]
+static double nowMs()
+{
+    return chrono::duration<double, milli>(chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void initFrameMonitor(FrameMonitor &mon, VideoCapture &cam, double fps)
+{
+    double cam_fps = cam.get(CAP_PROP_FPS);
+    mon = FrameMonitor();
+    mon.period_ms = 1000.0 / (cam_fps > 0 ? cam_fps : fps);
+}
+
+/* Counts the gap to the frame just grabbed and returns its timestamp.
+   Backends with no buffer timestamp report 0, so the time of the grab
+   stands in for it. */
+static double stamp(VideoCapture &cam, FrameMonitor &mon)
+{
+    double t = cam.get(CAP_PROP_POS_MSEC);
+    if (t <= 0)
+    {
+        t = nowMs();
+    }
+
+    if (mon.last_ms >= 0)
+    {
+        if (t <= mon.last_ms)
+        {
+            mon.stats.repeated++;
+        }
+        else
+        {
+            long gap = lround((t - mon.last_ms) / mon.period_ms); // Periods since the last frame
+            mon.stats.dropped += gap > 1 ? gap - 1 : 0;
+        }
+    }
+    mon.last_ms = t;
+    return t;
+}
+
+bool readNewest(VideoCapture &cam, FrameMonitor &mon, Mat &frame)
+{
+    if (!cam.grab())
+    {
+        return false;
+    }
+    double t = stamp(cam, mon);
+
+    // A frame this old means the next one is already queued, so grab() won't block
+    for (int i = 0; i < FRAME_SKIP_MAX && nowMs() - t > FRAME_STALE * mon.period_ms; i++)
+    {
+        if (!cam.grab())
+        {
+            return false;
+        }
+        mon.stats.skipped++;
+        t = stamp(cam, mon);
+    }
+
+    mon.read_ms = nowMs();
+    return cam.retrieve(frame);
+}
+
+void frameDone(FrameMonitor &mon)
+{
+    double ms = nowMs() - mon.read_ms;
+    mon.stats.frames++;
+    if (ms > mon.period_ms)
+    {
+        mon.stats.misses++;
+    }
+    if (ms > mon.stats.worst_ms)
+    {
+        mon.stats.worst_ms = ms;
+    }
+}
+
+void printFrameStats(const FrameStats &stats, const char *label)
+{
+    printf("%s: %ld, Dropped:%ld Skipped:%ld Repeated:%ld, Deadline misses:%ld, Worst:%.2fms\n",
+           label, stats.frames, stats.dropped, stats.skipped, stats.repeated, stats.misses, stats.worst_ms);
+}
@@ -0,0 +1,51 @@
+#ifndef FRAME_MONITOR_INCLUDED
+#define FRAME_MONITOR_INCLUDED
+
+#include <opencv2/opencv.hpp>
+
+/* Frame sequence and deadline accounting for the capture loop. Each frame's
+   V4L2 buffer timestamp (CAP_PROP_POS_MSEC, monotonic clock) is compared
+   with the one before, so a gap of two or more periods is a frame the camera
+   or driver dropped and the same timestamp is a buffer handed out twice.
+   Going frame to frame keeps a camera a little off its nominal rate, or
+   slowed by auto exposure, from drifting into false drops.
+
+   Each frame is due one period after it was read, when the next one comes
+   in. Running past that queues the next frame in the driver, so the read
+   skips frames that have waited longer than FRAME_STALE periods and goes
+   on from the newest one rather than falling further behind. */
+
+#define FRAME_STALE 1.5  // Age past which a queued frame is skipped [periods]
+#define FRAME_SKIP_MAX 4 // Most frames skipped per read, the V4L2 buffer count
+
+struct FrameStats
+{
+    long frames = 0;     // Processed
+    long dropped = 0;    // Never seen, missing from the sequence
+    long skipped = 0;    // Grabbed but too old to process
+    long repeated = 0;   // Same timestamp as the frame before
+    long misses = 0;     // Processing ran past the deadline
+    double worst_ms = 0; // Longest processing, read to frameDone()
+};
+
+struct FrameMonitor
+{
+    double period_ms = 1000.0 / 90;
+    double last_ms = -1; // Timestamp of the last frame grabbed
+    double read_ms = 0;  // When the frame being processed was read
+    FrameStats stats;
+};
+
+// Starts the count at the camera's frame rate, or fps if it does not report one
+void initFrameMonitor(FrameMonitor &mon, cv::VideoCapture &cam, double fps);
+
+// Reads the newest frame into frame, skipping stale ones. Returns false if the camera fails.
+bool readNewest(cv::VideoCapture &cam, FrameMonitor &mon, cv::Mat &frame);
+
+// Marks the frame from the last readNewest() as handled, counting a miss if it was late
+void frameDone(FrameMonitor &mon);
+
+// Prints the counters on one line after label
+void printFrameStats(const FrameStats &stats, const char *label);
+
+#endif
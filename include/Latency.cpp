@@ -0,0 +1,73 @@
+#include <Latency.h>
+
+#include <stdio.h>
+#include <string.h>
+
+bool loadLatencyModel(const char *path, LatencyModel &model)
+{
+    FILE *f = fopen(path, "r");
+    if (f == NULL)
+    {
+        return false;
+    }
+
+    char line[128], name[64];
+    float value;
+    while (fgets(line, sizeof(line), f) != NULL)
+    {
+        if (line[0] == '#' || sscanf(line, "%63s %f", name, &value) != 2)
+        {
+            continue; // Comment or blank line
+        }
+
+        if (strcmp(name, "exposure_ms") == 0)
+            model.exposure_ms = value;
+        else if (strcmp(name, "transfer_ms") == 0)
+            model.transfer_ms = value;
+        else if (strcmp(name, "processing_ms") == 0)
+            model.processing_ms = value;
+        else if (strcmp(name, "uart_ms") == 0)
+            model.uart_ms = value;
+        else if (strcmp(name, "step_start_ms") == 0)
+            model.step_start_ms = value;
+        else
+            fprintf(stderr, "%s: unknown entry %s\n", path, name);
+    }
+    fclose(f);
+    return true;
+}
+
+bool saveLatencyModel(const char *path, const LatencyModel &model)
+{
+    FILE *f = fopen(path, "w");
+    if (f == NULL)
+    {
+        return false;
+    }
+
+    fprintf(f, "# End-to-end latency model, written by latency_report\n");
+    fprintf(f, "exposure_ms %.2f\n", model.exposure_ms);
+    fprintf(f, "transfer_ms %.2f\n", model.transfer_ms);
+    fprintf(f, "processing_ms %.2f\n", model.processing_ms);
+    fprintf(f, "uart_ms %.2f\n", model.uart_ms);
+    fprintf(f, "step_start_ms %.2f\n", model.step_start_ms);
+    fclose(f);
+    return true;
+}
+
+float totalLatency(const LatencyModel &model)
+{
+    return (model.exposure_ms + model.transfer_ms + model.processing_ms +
+            model.uart_ms + model.step_start_ms) /
+           1000.0f;
+}
+
+void printLatencyModel(const LatencyModel &model)
+{
+    printf("%-12s %7.2f ms\n", "Exposure:", model.exposure_ms);
+    printf("%-12s %7.2f ms\n", "Transfer:", model.transfer_ms);
+    printf("%-12s %7.2f ms\n", "Processing:", model.processing_ms);
+    printf("%-12s %7.2f ms\n", "UART:", model.uart_ms);
+    printf("%-12s %7.2f ms\n", "Step start:", model.step_start_ms);
+    printf("%-12s %7.2f ms\n", "Total:", 1000.0f * totalLatency(model));
+}
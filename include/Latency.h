@@ -0,0 +1,29 @@
+#ifndef LATENCY_INCLUDED
+#define LATENCY_INCLUDED
+
+#define LATENCY_CFG "latency.cfg"
+
+/* Time from the puck being where the camera saw it to the motors
+   responding to the command generated from that frame. Each term is
+   measured offline with latency_report and stored in LATENCY_CFG. */
+struct LatencyModel
+{
+    float exposure_ms = 5.6;   // Mid-exposure to end of exposure (half a frame at 90 FPS)
+    float transfer_ms = 11.1;  // Sensor readout and USB transfer until cam.read() returns
+    float processing_ms = 3.0; // Warp, threshold, contours and strategy
+    float uart_ms = 0.35;      // 4 bytes at 115200 baud, 10 bits per byte
+    float step_start_ms = 2.0; // PSoC main loop pickup until the first step pulse
+};
+
+// Reads "name value" lines into model, keeping defaults for missing names.
+// Returns false if the file could not be opened.
+bool loadLatencyModel(const char *path, LatencyModel &model);
+
+bool saveLatencyModel(const char *path, const LatencyModel &model);
+
+// Total latency in seconds
+float totalLatency(const LatencyModel &model);
+
+void printLatencyModel(const LatencyModel &model);
+
+#endif
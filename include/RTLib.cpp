@@ -0,0 +1,247 @@
+#include <RTLib.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <malloc.h>
+#include <errno.h>
+#include <algorithm>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+
+void lockProcessMemory(size_t reserve)
+{
+    if (mlockall(MCL_CURRENT | MCL_FUTURE))
+    {
+        perror("mlockall failed");
+    }
+
+    mallopt(M_TRIM_THRESHOLD, -1); // Never give freed memory back to the kernel
+    mallopt(M_MMAP_MAX, 0);        // Every allocation from the heap, which stays locked
+    mallopt(M_ARENA_MAX, 1);       // Threads too, not from arenas of their own mapped later
+
+    /* Each write to a new page takes a fault, after which the page is locked
+       and, with trimming off, kept by malloc once the buffer is freed */
+    char *buffer = (char *)malloc(reserve);
+    if (buffer == NULL)
+    {
+        perror("reserve failed");
+        return;
+    }
+    long page = sysconf(_SC_PAGESIZE);
+    for (size_t i = 0; i < reserve; i += page)
+    {
+        buffer[i] = 0;
+    }
+    free(buffer);
+}
+
+struct RtThreadStart
+{
+    std::function<void()> body;
+    void *stack;
+};
+
+static void *rtThreadMain(void *arg)
+{
+    RtThreadStart *start = (RtThreadStart *)arg;
+    start->body();
+    delete start; // The stack is still in use, it is kept for the life of the process
+    return NULL;
+}
+
+static bool createThread(pthread_t &thread, const RtThreadConfig &config, RtThreadStart *start, bool realtime)
+{
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setstack(&attr, start->stack, config.stack_size);
+
+    if (realtime && config.priority > 0)
+    {
+        sched_param param;
+        param.sched_priority = config.priority;
+        pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+        pthread_attr_setschedpolicy(&attr, SCHED_FIFO);
+        pthread_attr_setschedparam(&attr, &param);
+    }
+    if (realtime && config.cpu >= 0)
+    {
+        cpu_set_t mask;
+        CPU_ZERO(&mask);
+        CPU_SET(config.cpu, &mask);
+        pthread_attr_setaffinity_np(&attr, sizeof(mask), &mask);
+    }
+
+    int err = pthread_create(&thread, &attr, rtThreadMain, start);
+    pthread_attr_destroy(&attr);
+    if (err != 0)
+    {
+        return false;
+    }
+    pthread_setname_np(thread, config.name);
+    return true;
+}
+
+bool startRtThread(pthread_t &thread, const RtThreadConfig &config, std::function<void()> body)
+{
+    // Allocated and touched here, under mlockall, so the thread never faults on it
+    void *stack = NULL;
+    if (posix_memalign(&stack, sysconf(_SC_PAGESIZE), config.stack_size) != 0)
+    {
+        return false;
+    }
+    memset(stack, 0, config.stack_size);
+
+    RtThreadStart *start = new RtThreadStart{body, stack};
+    if (createThread(thread, config, start, true))
+    {
+        printf("Thread %s: priority %d, cpu %d, %zu kB stack\n",
+               config.name, config.priority, config.cpu, config.stack_size / 1024);
+        return true;
+    }
+
+    fprintf(stderr, "Thread %s: cannot set priority %d / cpu %d, starting it as an ordinary thread\n",
+            config.name, config.priority, config.cpu);
+    if (createThread(thread, config, start, false))
+    {
+        return true;
+    }
+    delete start;
+    free(stack);
+    return false;
+}
+
+static PageFaults pageFaults(int who)
+{
+    struct rusage usage;
+    getrusage(who, &usage);
+    PageFaults faults;
+    faults.major = usage.ru_majflt;
+    faults.minor = usage.ru_minflt;
+    return faults;
+}
+
+PageFaults threadPageFaults()
+{
+    return pageFaults(RUSAGE_THREAD);
+}
+
+PageFaults processPageFaults()
+{
+    return pageFaults(RUSAGE_SELF);
+}
+
+static PageFaults last_faults;
+
+void showNewPageFaultCount(const char *logtext, const char *allowed_maj, const char *allowed_min)
+{
+    PageFaults faults = processPageFaults();
+    printf("%-30.30s: Pagefaults, Major:%ld (Allowed %s), "
+           "Minor:%ld (Allowed %s)\n",
+           logtext,
+           faults.major - last_faults.major, allowed_maj,
+           faults.minor - last_faults.minor, allowed_min);
+    last_faults = faults;
+}
+
+std::vector<int> readCpuList(const char *path)
+{
+    std::vector<int> cpus;
+    FILE *f = fopen(path, "r");
+    if (f == NULL)
+    {
+        return cpus;
+    }
+    int first, last;
+    while (fscanf(f, "%d", &first) == 1)
+    {
+        last = first;
+        if (fscanf(f, "-%d", &last) != 1)
+        {
+            last = first;
+        }
+        for (int cpu = first; cpu <= last; cpu++)
+        {
+            cpus.push_back(cpu);
+        }
+        if (fgetc(f) != ',')
+        {
+            break;
+        }
+    }
+    fclose(f);
+    return cpus;
+}
+
+int isolatedCpu()
+{
+    std::vector<int> isolated = readCpuList("/sys/devices/system/cpu/isolated");
+    std::vector<int> nohz = readCpuList("/sys/devices/system/cpu/nohz_full");
+    for (int cpu : isolated)
+    {
+        if (std::find(nohz.begin(), nohz.end(), cpu) != nohz.end())
+        {
+            return cpu;
+        }
+    }
+    return isolated.empty() ? -1 : isolated[0];
+}
+
+// Whether the /proc/interrupts line names one of the comma separated devices
+static bool irqMatches(const char *line, const char *devices)
+{
+    char names[256];
+    snprintf(names, sizeof(names), "%s", devices);
+    for (char *name = strtok(names, ","); name != NULL; name = strtok(NULL, ","))
+    {
+        if (strstr(line, name) != NULL)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+int moveIrqs(const char *devices, int cpu)
+{
+    FILE *f = fopen("/proc/interrupts", "r");
+    if (f == NULL)
+    {
+        perror("/proc/interrupts");
+        return 0;
+    }
+
+    int moved = 0;
+    char line[512];
+    while (fgets(line, sizeof(line), f) != NULL)
+    {
+        int irq;
+        char colon;
+        // Numbered lines only, not IPI0:, Err: and the like
+        if (sscanf(line, " %d%c", &irq, &colon) != 2 || colon != ':' || !irqMatches(strchr(line, ':'), devices))
+        {
+            continue;
+        }
+
+        char path[64];
+        snprintf(path, sizeof(path), "/proc/irq/%d/smp_affinity_list", irq);
+        FILE *affinity = fopen(path, "w");
+        bool ok = affinity != NULL && fprintf(affinity, "%d\n", cpu) > 0;
+        if (affinity != NULL && fclose(affinity) != 0)
+        {
+            ok = false; // The write only goes through on close
+        }
+        if (ok)
+        {
+            moved++;
+        }
+        else
+        {
+            fprintf(stderr, "IRQ %d: cannot move to cpu %d: %s\n", irq, cpu, strerror(errno));
+        }
+    }
+    fclose(f);
+    return moved;
+}
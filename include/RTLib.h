@@ -0,0 +1,71 @@
+#ifndef RTLIB_INCLUDED
+#define RTLIB_INCLUDED
+
+#include <pthread.h>
+#include <stddef.h>
+#include <functional>
+#include <vector>
+
+/* Real-time runtime for the vision pipeline. Memory is locked and the heap
+   prefaulted up front, and each pipeline thread gets SCHED_FIFO, an optional
+   core and a stack that is allocated and touched before the thread starts,
+   so nothing in the steady state loop should take a page fault.
+
+   On a kernel booted with isolcpus= (and ideally nohz_full=) the pipeline
+   can also have a core to itself, with the IRQs it waits on routed there. */
+
+#define RT_STACK_SIZE (512 * 1024) // Per thread, fixed [bytes]
+
+/* Heap prefaulted at startup by main.cpp, and by rt_fault_test to check it.
+   The vision thread itself does not allocate, but OpenCV's parallel_for_
+   workers do, out of AllocTrack's sight, and they take it from here. */
+#define RT_HEAP_RESERVE (16 * 1024 * 1024) // [bytes]
+
+// /proc/interrupts names of what the vision loop waits on, for moveIrqs()
+#define RT_CAMERA_IRQS "dwc_otg,xhci_hcd" // USB host controller, Pi 3 and Pi 4
+#define RT_UART_IRQS "serial,uart-pl011"  // Mini UART (ttyS0) and PL011
+
+struct RtThreadConfig
+{
+    const char *name = "rt"; // Shows in top -H, 15 characters at most
+    int priority = 80;       // SCHED_FIFO 1-99, 0 for an ordinary thread
+    int cpu = -1;            // Core to pin to, -1 for any
+    size_t stack_size = RT_STACK_SIZE;
+};
+
+struct PageFaults
+{
+    long major = 0;
+    long minor = 0;
+};
+
+// Locks current and future pages, stops malloc trimming and mmap use, then
+// touches reserve bytes of heap so later allocations come from locked pages
+void lockProcessMemory(size_t reserve);
+
+// Starts body on a new thread as configured. Falls back to an ordinary
+// thread if the priority or core cannot be set, e.g. without CAP_SYS_NICE.
+// Returns false only if the thread could not be started at all.
+bool startRtThread(pthread_t &thread, const RtThreadConfig &config, std::function<void()> body);
+
+// Page faults so far in the calling thread, or the whole process
+PageFaults threadPageFaults();
+PageFaults processPageFaults();
+
+// CPUs in a kernel cpu list file such as /sys/devices/system/cpu/isolated
+// ("1-2,4"), empty if the file is missing or blank
+std::vector<int> readCpuList(const char *path);
+
+// First core the scheduler leaves alone (isolcpus), preferring one that is
+// also tickless (nohz_full), or -1 if no core is isolated
+int isolatedCpu();
+
+// Routes every IRQ whose /proc/interrupts line names one of the comma
+// separated devices to cpu. Returns how many were moved, needs root. Some
+// interrupt controllers, the BCM2835 one among them, cannot route at all.
+int moveIrqs(const char *devices, int cpu);
+
+// Prints the page faults since the last call against what is allowed
+void showNewPageFaultCount(const char *logtext, const char *allowed_maj, const char *allowed_min);
+
+#endif
@@ -0,0 +1,276 @@
+#include <Recorder.h>
+
+#include <RTLib.h>
+#include <Vision.h>
+
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <algorithm>
+#include <string>
+
+using namespace std;
+using namespace cv;
+
+#define REC_FLUSH_RECORDS 90 // fflush() about once a second, what a crash can lose
+
+static size_t padded(size_t image_size)
+{
+    return (image_size + REC_ALIGN - 1) / REC_ALIGN * REC_ALIGN;
+}
+
+static void writerLoop(Recorder &rec)
+{
+    vector<uchar> png;
+    const vector<int> params = {IMWRITE_PNG_COMPRESSION, REC_PNG_LEVEL};
+    const uint8_t zeros[REC_ALIGN] = {0};
+    bool full = false;
+
+    while (true)
+    {
+        uint32_t tail = rec.tail.load(memory_order_relaxed);
+        if (tail == rec.head.load(memory_order_acquire))
+        {
+            if (rec.stop.load())
+            {
+                break;
+            }
+            usleep(5000); // Polled so the loop never makes a syscall to wake us
+            continue;
+        }
+
+        RecorderSlot &slot = rec.slots[tail % REC_SLOTS];
+        if (!full)
+        {
+            RecordHeader header = slot.header;
+            header.image_size = imencode(".png", slot.crop, png, params) ? png.size() : 0;
+            size_t pad = padded(header.image_size) - header.image_size;
+            size_t size = sizeof(header) + header.image_size + pad;
+            if (rec.bytes + (long long)size > REC_MAX_BYTES)
+            {
+                printf("Recorder: %s is full, recording stopped\n", rec.path);
+                full = true;
+            }
+            else if (fwrite(&header, sizeof(header), 1, rec.file) != 1 ||
+                     fwrite(png.data(), 1, header.image_size, rec.file) != header.image_size ||
+                     fwrite(zeros, 1, pad, rec.file) != pad)
+            {
+                fprintf(stderr, "Recorder: writing %s: %s, recording stopped\n", rec.path, strerror(errno));
+                full = true;
+            }
+            else
+            {
+                rec.bytes += size;
+                if (++rec.written % REC_FLUSH_RECORDS == 0)
+                {
+                    fflush(rec.file);
+                }
+            }
+        }
+        rec.tail.store(tail + 1, memory_order_release); // Slot free for the loop again
+    }
+}
+
+// Deletes the oldest logs in dir until the rest and a full new one fit in
+// REC_DIR_MAX_BYTES. Logs are named after the time, so by name is by age.
+static void pruneRecordings(const char *dir)
+{
+    DIR *d = opendir(dir);
+    if (d == nullptr)
+    {
+        return;
+    }
+    vector<pair<string, long long>> logs;
+    long long total = 0;
+    while (struct dirent *e = readdir(d))
+    {
+        size_t len = strlen(e->d_name);
+        struct stat st;
+        string path = string(dir) + "/" + e->d_name;
+        if (len > 4 && strcmp(e->d_name + len - 4, ".bhr") == 0 && stat(path.c_str(), &st) == 0)
+        {
+            logs.push_back({path, (long long)st.st_size});
+            total += st.st_size;
+        }
+    }
+    closedir(d);
+
+    sort(logs.begin(), logs.end());
+    for (size_t i = 0; i < logs.size() && total + REC_MAX_BYTES > REC_DIR_MAX_BYTES; i++)
+    {
+        if (unlink(logs[i].first.c_str()) == 0)
+        {
+            printf("Recorder: deleted %s to make room\n", logs[i].first.c_str());
+            total -= logs[i].second;
+        }
+    }
+}
+
+bool startRecorder(Recorder &rec, const char *dir)
+{
+    mkdir(dir, 0755);
+    pruneRecordings(dir);
+    time_t now = time(NULL);
+    char stamp[32];
+    strftime(stamp, sizeof(stamp), "%Y%m%d-%H%M%S", localtime(&now));
+    snprintf(rec.path, sizeof(rec.path), "%s/%s.bhr", dir, stamp);
+
+    rec.file = fopen(rec.path, "wb");
+    if (rec.file == nullptr)
+    {
+        fprintf(stderr, "Unable to open %s: %s\n", rec.path, strerror(errno));
+        return false;
+    }
+
+    RecordingHeader header;
+    header.record_header_size = sizeof(RecordHeader);
+    header.roi_x = ROI_1.x, header.roi_y = ROI_1.y;
+    header.roi_cols = ROI_1.width, header.roi_rows = ROI_1.height;
+    header.frame_cols = FRM_COLS, header.frame_rows = FRM_ROWS;
+    // Flushed so a full or read only disk shows now, not as a log with no header
+    if (fwrite(&header, sizeof(header), 1, rec.file) != 1 || fflush(rec.file) != 0)
+    {
+        fprintf(stderr, "Recorder: writing %s: %s\n", rec.path, strerror(errno));
+        fclose(rec.file);
+        rec.file = nullptr;
+        unlink(rec.path);
+        return false;
+    }
+    rec.bytes = sizeof(header);
+
+    for (RecorderSlot &slot : rec.slots)
+    {
+        slot.crop.create(ROI_1.size(), CV_8UC3);
+    }
+
+    // An ordinary thread on any core but the loop's isolated one
+    RtThreadConfig config;
+    config.name = "recorder";
+    config.priority = 0;
+    if (!startRtThread(rec.thread, config, [&rec] { writerLoop(rec); }))
+    {
+        fclose(rec.file);
+        rec.file = nullptr;
+        return false;
+    }
+    printf("Recording to %s\n", rec.path);
+    return true;
+}
+
+void recordFrame(Recorder &rec, const Mat &frame, const RecordHeader &header)
+{
+    if (rec.file == nullptr)
+    {
+        return;
+    }
+    uint32_t head = rec.head.load(memory_order_relaxed);
+    if (head - rec.tail.load(memory_order_acquire) >= REC_SLOTS)
+    {
+        rec.dropped++;
+        return;
+    }
+    RecorderSlot &slot = rec.slots[head % REC_SLOTS];
+    slot.header = header;
+    frame(ROI_1).copyTo(slot.crop); // Same size and type, so into the slot's own buffer
+    rec.head.store(head + 1, memory_order_release);
+}
+
+void stopRecorder(Recorder &rec)
+{
+    if (rec.file == nullptr)
+    {
+        return;
+    }
+    rec.stop.store(true);
+    pthread_join(rec.thread, NULL);
+    fclose(rec.file);
+    rec.file = nullptr;
+    printf("Recorder: %ld frames, %.1f MB in %s, %ld dropped\n", rec.written, rec.bytes / 1e6, rec.path, rec.dropped);
+}
+
+bool openRecording(const char *path, Recording &rec)
+{
+    rec = Recording();
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+    {
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(RecordingHeader))
+    {
+        close(fd);
+        return false;
+    }
+    void *p = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED)
+    {
+        return false;
+    }
+    rec.data = (const uint8_t *)p;
+    rec.size = st.st_size;
+
+    memcpy(&rec.header, rec.data, sizeof(rec.header));
+    if (rec.header.magic != REC_MAGIC || rec.header.version != REC_VERSION ||
+        rec.header.record_header_size != sizeof(RecordHeader))
+    {
+        closeRecording(rec);
+        return false;
+    }
+
+    // Hop from header to header, stopping at a torn or corrupt record
+    size_t offset = sizeof(RecordingHeader);
+    while (offset + sizeof(RecordHeader) <= rec.size)
+    {
+        const RecordHeader &h = *(const RecordHeader *)(rec.data + offset);
+        size_t next = offset + sizeof(RecordHeader) + padded(h.image_size);
+        if (h.magic != REC_RECORD || next > rec.size)
+        {
+            break;
+        }
+        rec.offsets.push_back(offset);
+        offset = next;
+    }
+    return true;
+}
+
+const RecordHeader &recordAt(const Recording &rec, size_t i)
+{
+    return *(const RecordHeader *)(rec.data + rec.offsets[i]);
+}
+
+bool recordFrameImage(const Recording &rec, size_t i, Mat &frame)
+{
+    const RecordHeader &h = recordAt(rec, i);
+    if (h.image_size == 0)
+    {
+        return false;
+    }
+    // Decoded straight out of the mapping, no copy of the PNG
+    Mat png(1, h.image_size, CV_8UC1, (void *)(rec.data + rec.offsets[i] + sizeof(RecordHeader)));
+    Mat crop = imdecode(png, IMREAD_COLOR);
+    Rect roi(rec.header.roi_x, rec.header.roi_y, rec.header.roi_cols, rec.header.roi_rows);
+    if (crop.empty() || crop.size() != roi.size())
+    {
+        return false;
+    }
+    frame.create(rec.header.frame_rows, rec.header.frame_cols, CV_8UC3);
+    frame.setTo(Scalar::all(0));
+    crop.copyTo(frame(roi));
+    return true;
+}
+
+void closeRecording(Recording &rec)
+{
+    if (rec.data != nullptr)
+    {
+        munmap((void *)rec.data, rec.size);
+    }
+    rec = Recording();
+}
@@ -0,0 +1,120 @@
+#ifndef RECORDER_INCLUDED
+#define RECORDER_INCLUDED
+
+#include <opencv2/opencv.hpp>
+#include <stdint.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <atomic>
+#include <vector>
+
+#include <Telemetry.h>
+
+/* Session log for going back over a bad save. Each frame the loop hands the
+   recorder its ROI_1 crop, the only part of the frame findPuck() looks at,
+   along with what it detected, predicted and sent, and the state it went into
+   the frame with. That is everything needed to run the frame again
+   on its own, see tools/replay.cpp.
+
+   The loop only copies the crop into one of REC_SLOTS preallocated slots.
+   A low priority thread compresses it to PNG, which is lossless, and appends
+   it to the log. If that thread falls REC_SLOTS frames behind, frames are
+   dropped and counted rather than queued without bound.
+
+   The log is a RecordingHeader and then one record after another, each a
+   RecordHeader and its PNG. Nothing is written at the end, so a log cut short
+   by a crash or power loss still reads up to its last whole record.
+
+   Every run starts a new log, so before it does, the oldest logs are deleted
+   until the ones left and a full new one fit in REC_DIR_MAX_BYTES. Copy a
+   log elsewhere to keep it. */
+
+#define REC_DIR "recordings"
+#define REC_SLOTS 32                         // Frames queued for the writer, 0.35 s at 90 FPS
+#define REC_MAX_BYTES (2048LL * 1024 * 1024) // Recording stops at this log size
+#define REC_DIR_MAX_BYTES (8192LL * 1024 * 1024) // Oldest logs in REC_DIR deleted to keep it under this
+#define REC_PNG_LEVEL 1                      // Fastest zlib level, the writer has to keep up with 90 FPS
+
+#define REC_MAGIC 0x43455248  // "HREC", file
+#define REC_RECORD 0x44524352 // "RCRD", every record, to catch a corrupt log
+#define REC_VERSION 1
+#define REC_ALIGN 8 // Records start on a multiple of this, the PNG is padded out to it
+
+struct RecordingHeader
+{
+    uint32_t magic = REC_MAGIC;
+    uint32_t version = REC_VERSION;
+    uint32_t record_header_size = 0; // sizeof(RecordHeader)
+    int32_t roi_x = 0, roi_y = 0, roi_cols = 0, roi_rows = 0; // ROI_1 in the frame
+    int32_t frame_cols = 0, frame_rows = 0;
+    uint32_t reserved = 0;
+};
+static_assert(REC_DIR_MAX_BYTES >= REC_MAX_BYTES, "Room for at least the new log");
+static_assert(sizeof(RecordingHeader) % REC_ALIGN == 0, "Records must stay aligned");
+
+struct RecordHeader
+{
+    uint32_t magic = REC_RECORD;
+    uint32_t image_size = 0; // PNG bytes after the header, 0 if it could not be encoded, then padding to REC_ALIGN
+    TelemetryFrame track;    // What the loop detected, predicted and sent
+
+    // Loop state going into the frame
+    float x_0 = 0, y_0 = 0; // Puck two detections back, the velocity is taken against it
+    float x_1 = 0, y_1 = 0; // Last detection
+    float t_delta = 0;      // Time over which the velocity was taken [s]
+    float latency = 0;      // Forward prediction horizon [s]
+    int32_t strategy_state = 0, threat_frames = 0;
+};
+static_assert(sizeof(RecordHeader) % REC_ALIGN == 0, "Records must stay aligned");
+
+struct RecorderSlot
+{
+    RecordHeader header;
+    cv::Mat crop;
+};
+
+struct Recorder
+{
+    FILE *file = nullptr;
+    char path[64];
+    RecorderSlot slots[REC_SLOTS];
+    std::atomic<uint32_t> head{0}, tail{0}; // Filled by the loop, emptied by the writer
+    std::atomic<bool> stop{false};
+    pthread_t thread;
+    long dropped = 0; // Slot not free, loop side
+    long written = 0; // Writer side
+    long long bytes = 0;
+};
+
+// Makes room in dir, opens a new log there named after the time, allocates
+// the slots and starts the writer
+bool startRecorder(Recorder &rec, const char *dir);
+
+// Queues one frame, from the loop. Copies frame's ROI_1 crop, never blocks or allocates.
+void recordFrame(Recorder &rec, const cv::Mat &frame, const RecordHeader &header);
+
+// Writes out what is queued, stops the writer and closes the log
+void stopRecorder(Recorder &rec);
+
+/* A log mapped read only, with the offset of every whole record, so any
+   frame can be read without going through the ones before it */
+struct Recording
+{
+    const uint8_t *data = nullptr;
+    size_t size = 0;
+    RecordingHeader header;
+    std::vector<size_t> offsets;
+};
+
+// Maps and indexes a log. Returns false if it is not one.
+bool openRecording(const char *path, Recording &rec);
+
+const RecordHeader &recordAt(const Recording &rec, size_t i);
+
+// Decodes record i's crop into a frame sized black image at ROI_1, as the
+// camera frame findPuck() saw. Returns false if the record has no image.
+bool recordFrameImage(const Recording &rec, size_t i, cv::Mat &frame);
+
+void closeRecording(Recording &rec);
+
+#endif
@@ -0,0 +1,68 @@
+#include <Strategy.h>
+#include <Table.h>
+
+#include <math.h>
+
+const StrategyParams STRATEGY_PARAMS[NUM_DIFFICULTIES] = {
+    // gate_y  lane_margin  left_max  right_min  bank_delta  strike_y  straight_y  reaction_frames  max_speed
+    {  80,     5,           65,       75,        40,         0,        0,          0,               INFINITY }, // Easy
+    {  80,     30,          65,       75,        20,         0,        0,          0,               INFINITY }, // Medium
+    {  80,     30,          65,       75,        20,         20,       20,         0,               INFINITY }, // Hard
+};
+
+const char *const STRATEGY_STATE_NAMES[NUM_STATES] = {"Wait", "Catch", "Bank Left", "Straight", "Bank Right"};
+
+static inline int8_t clampGoal(float x)
+{
+    if (isnan(x))
+    {
+        return PUCK_HOME;
+    }
+    return (int8_t)(x < GOAL_MIN_X ? GOAL_MIN_X : x > GOAL_MAX_X ? GOAL_MAX_X : x);
+}
+
+bool strategyCommand(Strategy &s, int difficulty, const PuckState &puck, float x_pred, int8_t cmd[2])
+{
+    const StrategyParams &sp = STRATEGY_PARAMS[difficulty];
+
+    // Threat counter runs up while the puck is past the gate and approaching,
+    // and drops straight back to zero once it is not
+    bool threat = puck.pos.y > sp.gate_y && puck.vel.y > 0;
+    s.threat_frames = threat * (s.threat_frames + 1);
+    if (s.threat_frames <= sp.reaction_frames)
+    {
+        s.state = WAIT;
+        return false;
+    }
+
+    // Lane from the predicted intercept: comparisons are 0/1, a NaN falls through to STRAIGHT
+    int left = x_pred >= GOAL_MIN_X - sp.lane_margin && x_pred <= sp.left_max;
+    int right = x_pred <= GOAL_MAX_X + sp.lane_margin && x_pred >= sp.right_min;
+    int state = STRAIGHT - left + right;
+
+    float speed2 = puck.vel.x * puck.vel.x + puck.vel.y * puck.vel.y;
+    if (speed2 > sp.max_speed * sp.max_speed)
+    {
+        state = CATCH;
+    }
+    s.state = (StrategyState)state;
+
+    // Mallet target per state, indexed rather than branched on
+    const int8_t target_x[NUM_STATES] = {PUCK_HOME, clampGoal(x_pred), (int8_t)(PUCK_HOME - sp.bank_delta),
+                                         PUCK_HOME, (int8_t)(PUCK_HOME + sp.bank_delta)};
+    const int8_t target_y[NUM_STATES] = {0, 0, sp.strike_y, sp.straight_y, sp.strike_y};
+    cmd[0] = target_x[state];
+    cmd[1] = target_y[state];
+    return true;
+}
+
+void commandPacket(int8_t packet[4], bool waiting, float puck_x, float puck_y)
+{
+    if (waiting)
+    {
+        packet[0] = PUCK_HOME;
+        packet[1] = 0;
+    }
+    packet[2] = cvRound(puck_x); // Round sub-pixel position to nearest pixel
+    packet[3] = cvRound(puck_y);
+}
@@ -0,0 +1,53 @@
+#ifndef STRATEGY_INCLUDED
+#define STRATEGY_INCLUDED
+
+#include <stdint.h>
+#include <Tracker.h>
+
+#define NUM_DIFFICULTIES 3 // [0, 1, 2] = [Easy, Medium, Hard]
+
+enum StrategyState
+{
+    WAIT,       // No threat, mallet at home
+    CATCH,      // Too fast to strike, block on the predicted line
+    BANK_LEFT,  // Strike from the left of home
+    STRAIGHT,   // Strike from home
+    BANK_RIGHT, // Strike from the right of home
+    NUM_STATES
+};
+
+/* Everything that makes one difficulty differ from another. Adding a
+   behaviour means adding a column here, not another branch per difficulty. */
+struct StrategyParams
+{
+    float gate_y;          // Puck must be past this y and approaching before the mallet moves
+    float lane_margin;     // How far outside the goal a predicted intercept still banks [px]
+    float left_max;        // Intercepts between left_max and right_min are struck straight
+    float right_min;
+    int8_t bank_delta;     // Lateral offset from PUCK_HOME when banking [px]
+    int8_t strike_y;       // Gantry y for a bank strike
+    int8_t straight_y;     // Gantry y for a straight strike
+    int reaction_frames;   // Consecutive threatening frames before leaving WAIT
+    float max_speed;       // Faster pucks are caught instead of struck [px/s]
+};
+
+extern const StrategyParams STRATEGY_PARAMS[NUM_DIFFICULTIES];
+
+extern const char *const STRATEGY_STATE_NAMES[NUM_STATES];
+
+// Per-game state carried between frames. Reset it when a new game starts.
+struct Strategy
+{
+    StrategyState state = WAIT;
+    int threat_frames = 0;
+};
+
+// Advances the state machine by one frame and writes the mallet target
+// (gantry x, y) into cmd. Returns false if the mallet should wait at home.
+bool strategyCommand(Strategy &s, int difficulty, const PuckState &puck, float x_pred, int8_t cmd[2]);
+
+// Fills in the rest of the 4-byte packet to the PSoC, [gantry x, gantry y,
+// puck x, puck y]: the gantry goes home if waiting, the puck is rounded
+void commandPacket(int8_t packet[4], bool waiting, float puck_x, float puck_y);
+
+#endif
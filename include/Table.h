@@ -0,0 +1,24 @@
+#ifndef TABLE_INCLUDED
+#define TABLE_INCLUDED
+
+/***************Table geometry in corrected camera pixels******************/
+// Puck goes from
+// X = 8 to X = 139
+// Y = 3 to Y = 180 (limit of camera vision, not end of table)
+// Middle of table is X = 70 Y = 112
+#define X_MIN 8
+#define Y_MIN 3
+#define X_MAX 139
+#define Y_MAX 200
+
+// Goal is between X = 42 and X = 103
+#define GOAL_MIN_X 38
+#define GOAL_MAX_X 108
+
+#define PUCK_HOME 68
+
+// Fraction of speed kept after bouncing off a side wall (see trajectory_testing)
+#define WALL_RESTITUTION (17.0f / 20.0f)
+/* ****************************************************************/
+
+#endif
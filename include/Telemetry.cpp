@@ -0,0 +1,128 @@
+#include <Telemetry.h>
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <grp.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+
+bool openTelemetry(Telemetry &tel)
+{
+    tel = Telemetry();
+    tel.fd = socket(AF_UNIX, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (tel.fd < 0)
+    {
+        perror("telemetry socket");
+        return false;
+    }
+
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, TELEMETRY_PATH, sizeof(addr.sun_path) - 1);
+    unlink(TELEMETRY_PATH); // Left behind if the last run was killed
+    if (bind(tel.fd, (struct sockaddr *)&addr, sizeof(addr)) != 0)
+    {
+        fprintf(stderr, "Unable to bind %s: %s\n", TELEMETRY_PATH, strerror(errno));
+        close(tel.fd);
+        tel.fd = -1;
+        return false;
+    }
+    // main.cpp runs as root for SCHED_FIFO, the GUI as a desktop user in the group
+    struct group *group = getgrnam(TELEMETRY_GROUP);
+    if (group == NULL)
+    {
+        printf("No %s group, only root can use %s\n", TELEMETRY_GROUP, TELEMETRY_PATH);
+        chmod(TELEMETRY_PATH, 0600);
+    }
+    else if (chown(TELEMETRY_PATH, -1, group->gr_gid) != 0 || chmod(TELEMETRY_PATH, 0660) != 0)
+    {
+        fprintf(stderr, "Unable to give %s to group %s: %s\n", TELEMETRY_PATH, TELEMETRY_GROUP, strerror(errno));
+    }
+    return true;
+}
+
+static int findSub(const Telemetry &tel, const struct sockaddr_un &addr)
+{
+    for (int i = 0; i < tel.sub_count; i++)
+    {
+        if (strcmp(tel.subs[i].sun_path, addr.sun_path) == 0)
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static void dropSub(Telemetry &tel, int i)
+{
+    tel.subs[i] = tel.subs[--tel.sub_count];
+}
+
+int pollTelemetry(Telemetry &tel, int timeout_ms)
+{
+    if (tel.fd < 0)
+    {
+        return 0;
+    }
+    if (timeout_ms > 0)
+    {
+        struct pollfd p = {tel.fd, POLLIN, 0};
+        poll(&p, 1, timeout_ms);
+    }
+
+    TelemetryRequest req;
+    struct sockaddr_un from;
+    socklen_t from_len = sizeof(from);
+    memset(&from, 0, sizeof(from));
+    while (recvfrom(tel.fd, &req, sizeof(req), 0, (struct sockaddr *)&from, &from_len) == sizeof(req))
+    {
+        int i = findSub(tel, from);
+        switch (req.type)
+        {
+        case TELEM_SUBSCRIBE:
+            if (i < 0 && tel.sub_count < TELEMETRY_MAX_SUBS && from.sun_path[0] != '\0')
+            {
+                tel.subs[tel.sub_count++] = from;
+                printf("Telemetry: %s subscribed\n", from.sun_path);
+            }
+            break;
+        case TELEM_UNSUBSCRIBE:
+            if (i >= 0)
+            {
+                dropSub(tel, i);
+            }
+            break;
+        case TELEM_COMMAND:
+            return req.value;
+        }
+        from_len = sizeof(from);
+        memset(&from, 0, sizeof(from));
+    }
+    return 0;
+}
+
+void publishTelemetry(Telemetry &tel, const void *msg, size_t size)
+{
+    for (int i = 0; i < tel.sub_count; i++)
+    {
+        if (sendto(tel.fd, msg, size, MSG_DONTWAIT, (struct sockaddr *)&tel.subs[i], sizeof(tel.subs[i])) < 0 &&
+            (errno == ECONNREFUSED || errno == ENOENT))
+        {
+            dropSub(tel, i--); // Closed without unsubscribing
+        }
+    }
+}
+
+void closeTelemetry(Telemetry &tel)
+{
+    if (tel.fd >= 0)
+    {
+        close(tel.fd);
+        unlink(TELEMETRY_PATH);
+        tel.fd = -1;
+    }
+}
@@ -0,0 +1,91 @@
+#ifndef TELEMETRY_INCLUDED
+#define TELEMETRY_INCLUDED
+
+#include <stdint.h>
+#include <sys/un.h>
+
+#define TELEMETRY_PATH "/tmp/bairhockey.sock"
+#define TELEMETRY_GROUP "bairhockey" // Who may connect, add the GUI's user to it
+
+/* Local publish/subscribe between main.cpp and the GUI, so only main.cpp
+   talks to the PSoC over the UART. main.cpp owns a Unix datagram socket at
+   TELEMETRY_PATH. A client binds a socket of its own, sends it a
+   TelemetryRequest to subscribe and then gets a TelemetryStats every audit
+   window. Control commands come in the same way. The per-frame
+   TelemetryFrame goes through the track ring instead, see TrackRing.h. Nothing blocks: a subscriber that falls behind loses messages,
+   and one that has gone away is dropped.
+
+   Messages are fixed little-endian structs, see rpi_gui_code/QtBairHockey.py
+   for the Python struct formats. */
+
+#define TELEMETRY_MAX_SUBS 4
+
+// Message types, the first byte of every message
+#define TELEM_SUBSCRIBE 1 // Client to main.cpp
+#define TELEM_UNSUBSCRIBE 2
+#define TELEM_COMMAND 3 // value is a control byte below
+#define TELEM_FRAME 16  // Track ring records
+#define TELEM_STATS 17  // main.cpp to subscribers
+
+// Control bytes, the ones the GUI used to send over the UART
+#define CMD_EASY '0'
+#define CMD_MEDIUM '1'
+#define CMD_HARD '2'
+#define CMD_RUN '3'
+#define CMD_STOP '4'
+
+struct TelemetryRequest
+{
+    uint8_t type;
+    uint8_t value;
+};
+
+// '<BBBB4bQI5f'
+struct TelemetryFrame
+{
+    uint8_t type = TELEM_FRAME;
+    uint8_t found;        // Puck seen this frame
+    uint8_t waiting;      // Mallet sent home rather than at the puck
+    uint8_t difficulty;
+    int8_t coord[4];      // Mallet command as sent to the PSoC
+    uint64_t t_ns;        // When it was sent, CLOCK_MONOTONIC
+    uint32_t seq;         // Frames processed since the start
+    float puck_x, puck_y; // Corrected table [px]
+    float v_x, v_y;       // [px/s]
+    float x_pred;         // Where the puck crosses Y_MAX [px]
+};
+static_assert(sizeof(TelemetryFrame) == 40, "TelemetryFrame layout is shared with the GUI");
+
+// '<B3x8If', counts over the last audit window
+struct TelemetryStats
+{
+    uint8_t type = TELEM_STATS;
+    uint32_t frames, dropped, skipped, repeated, misses;
+    uint32_t allocs, faults_major, faults_minor;
+    float worst_ms;
+};
+static_assert(sizeof(TelemetryStats) == 40, "TelemetryStats layout is shared with the GUI");
+
+struct Telemetry
+{
+    int fd = -1;
+    struct sockaddr_un subs[TELEMETRY_MAX_SUBS];
+    int sub_count = 0;
+};
+
+/* Binds TELEMETRY_PATH, replacing a stale socket. Returns false if it cannot.
+   The socket takes control commands, so only TELEMETRY_GROUP may connect:
+       sudo groupadd bairhockey && sudo usermod -aG bairhockey pi
+   Without the group only root can. */
+bool openTelemetry(Telemetry &tel);
+
+// Handles subscriptions waiting on the socket and returns the next control
+// byte, or 0 if there is none. Waits up to timeout_ms for one, 0 to not wait.
+int pollTelemetry(Telemetry &tel, int timeout_ms);
+
+// Sends msg to every subscriber without blocking
+void publishTelemetry(Telemetry &tel, const void *msg, size_t size);
+
+void closeTelemetry(Telemetry &tel);
+
+#endif
@@ -0,0 +1,183 @@
+#include <Trace.h>
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <atomic>
+
+const char *const TRACE_STAGE_NAMES[NUM_TRACE_STAGES] = {
+    "frame", "capture", "warp", "threshold", "blobs", "predict", "uart"};
+
+#define TRACE_HDR_SUB (1 << TRACE_HDR_SUB_BITS)
+
+struct TraceEvent
+{
+    uint64_t start_ns;
+    uint32_t dur_ns;
+    uint32_t stage;
+};
+
+struct TraceHistogram
+{
+    uint32_t count[TRACE_HDR_BUCKETS];
+    uint64_t total, sum_ns, max_ns;
+};
+
+struct TraceBuffer
+{
+    char name[16];
+    std::atomic<uint64_t> head; // Events written, only the owner writes it
+    TraceEvent ring[TRACE_RING];
+    TraceHistogram hist[NUM_TRACE_STAGES];
+};
+
+// Static so they are locked and faulted in by mlockall() with the rest of .bss
+static TraceBuffer buffers[TRACE_MAX_THREADS];
+static std::atomic<int> buffer_count(0);
+static __thread TraceBuffer *own = NULL;
+static __thread bool full = false;
+
+uint64_t traceNow()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + ts.tv_nsec;
+}
+
+static TraceBuffer *ownBuffer()
+{
+    if (own == NULL && !full)
+    {
+        int i = buffer_count.fetch_add(1);
+        if (i >= TRACE_MAX_THREADS)
+        {
+            full = true; // Untraced, rather than sharing a buffer and needing locks
+            return NULL;
+        }
+        own = &buffers[i];
+        pthread_getname_np(pthread_self(), own->name, sizeof(own->name));
+    }
+    return own;
+}
+
+/* Log-linear index: exact below TRACE_HDR_SUB, then TRACE_HDR_SUB steps per
+   power of two */
+static int hdrIndex(uint64_t v)
+{
+    if (v < TRACE_HDR_SUB)
+    {
+        return (int)v;
+    }
+    int shift = 63 - __builtin_clzll(v) - TRACE_HDR_SUB_BITS;
+    int i = (shift + 1) * TRACE_HDR_SUB + (int)((v >> shift) - TRACE_HDR_SUB);
+    return i < TRACE_HDR_BUCKETS ? i : TRACE_HDR_BUCKETS - 1;
+}
+
+// Lowest value that lands in bucket i
+static uint64_t hdrValue(int i)
+{
+    if (i < TRACE_HDR_SUB)
+    {
+        return i;
+    }
+    int shift = i / TRACE_HDR_SUB - 1;
+    return (uint64_t)(i % TRACE_HDR_SUB + TRACE_HDR_SUB) << shift;
+}
+
+void traceRecord(TraceStage stage, uint64_t start_ns, uint64_t end_ns)
+{
+    TraceBuffer *b = ownBuffer();
+    if (b == NULL)
+    {
+        return;
+    }
+    uint64_t dur = end_ns - start_ns;
+
+    uint64_t head = b->head.load(std::memory_order_relaxed);
+    TraceEvent &e = b->ring[head & (TRACE_RING - 1)];
+    e.start_ns = start_ns;
+    e.dur_ns = dur > UINT32_MAX ? UINT32_MAX : (uint32_t)dur;
+    e.stage = stage;
+    b->head.store(head + 1, std::memory_order_release);
+
+    TraceHistogram &h = b->hist[stage];
+    h.count[hdrIndex(dur)]++;
+    h.total++;
+    h.sum_ns += dur;
+    if (dur > h.max_ns)
+    {
+        h.max_ns = dur;
+    }
+}
+
+static double percentile(const TraceHistogram &h, double p)
+{
+    uint64_t rank = (uint64_t)(p * h.total), seen = 0;
+    for (int i = 0; i < TRACE_HDR_BUCKETS; i++)
+    {
+        seen += h.count[i];
+        if (seen > rank)
+        {
+            return hdrValue(i) / 1000.0;
+        }
+    }
+    return h.max_ns / 1000.0;
+}
+
+void tracePrintHistograms(bool reset)
+{
+    TraceBuffer *b = ownBuffer();
+    if (b == NULL)
+    {
+        return;
+    }
+    printf("%-10s %7s %9s %9s %9s %9s %9s %9s [us]\n", "stage", "n", "mean", "p50", "p90", "p99", "p99.9", "max");
+    for (int s = 0; s < NUM_TRACE_STAGES; s++)
+    {
+        TraceHistogram &h = b->hist[s];
+        if (h.total == 0)
+        {
+            continue;
+        }
+        printf("%-10s %7llu %9.1f %9.1f %9.1f %9.1f %9.1f %9.1f\n", TRACE_STAGE_NAMES[s],
+               (unsigned long long)h.total, h.sum_ns / 1000.0 / h.total,
+               percentile(h, 0.5), percentile(h, 0.9), percentile(h, 0.99), percentile(h, 0.999), h.max_ns / 1000.0);
+        if (reset)
+        {
+            memset(&h, 0, sizeof(h));
+        }
+    }
+}
+
+bool traceWriteChrome(const char *path)
+{
+    FILE *f = fopen(path, "w");
+    if (f == NULL)
+    {
+        return false;
+    }
+
+    fprintf(f, "{\"traceEvents\":[\n");
+    bool first = true;
+    int threads = buffer_count.load();
+    for (int t = 0; t < threads && t < TRACE_MAX_THREADS; t++)
+    {
+        TraceBuffer &b = buffers[t];
+        fprintf(f, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+                first ? "" : ",\n", t, b.name);
+        first = false;
+
+        // Only the newest TRACE_RING events are still there
+        uint64_t head = b.head.load(std::memory_order_acquire);
+        uint64_t tail = head > TRACE_RING ? head - TRACE_RING : 0;
+        for (uint64_t i = tail; i < head; i++)
+        {
+            const TraceEvent &e = b.ring[i & (TRACE_RING - 1)];
+            fprintf(f, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+                    TRACE_STAGE_NAMES[e.stage], t, e.start_ns / 1000.0, e.dur_ns / 1000.0);
+        }
+    }
+    fprintf(f, "\n]}\n");
+    return fclose(f) == 0;
+}
@@ -0,0 +1,73 @@
+#ifndef TRACE_INCLUDED
+#define TRACE_INCLUDED
+
+#include <stdint.h>
+
+/* Per-stage timing of the vision pipeline. Each thread records into its own
+   statically allocated buffer, an event ring and an HDR histogram per stage,
+   with no locks and no allocation. A stage costs two clock_gettime() calls,
+   under a microsecond per frame for all of them against an 11 ms frame.
+
+   Histograms are printed and reset by the thread that owns them, the event
+   rings can be written out as a Chrome trace (chrome://tracing or
+   ui.perfetto.dev) once the threads have stopped. */
+
+#ifndef TRACE
+#define TRACE 1 // 0 compiles every TRACE_ macro out
+#endif
+
+#define TRACE_MAX_THREADS 4
+#define TRACE_RING 65536      // Events kept per thread, 80 s at 90 FPS, power of two
+#define TRACE_HDR_SUB_BITS 5  // 32 linear sub-buckets per power of two, 3% resolution
+#define TRACE_HDR_BUCKETS 1024 // Up to 2^35 ns
+
+enum TraceStage
+{
+    TRACE_FRAME,     // Whole loop iteration
+    TRACE_CAPTURE,   // cam.read(), including the wait for the frame
+    TRACE_WARP,      // Crop and perspective correction
+    TRACE_THRESHOLD, // inRange and median filter
+    TRACE_BLOBS,     // Blob search and centroid
+    TRACE_PREDICT,   // Forward prediction and strategy
+    TRACE_UART,      // Command write to the PSoC
+    NUM_TRACE_STAGES
+};
+
+extern const char *const TRACE_STAGE_NAMES[NUM_TRACE_STAGES];
+
+// CLOCK_MONOTONIC [ns]
+uint64_t traceNow();
+
+// Adds one run of stage on the calling thread
+void traceRecord(TraceStage stage, uint64_t start_ns, uint64_t end_ns);
+
+// Prints count, mean and percentiles per stage for the calling thread, then
+// starts the histograms again if reset is set
+void tracePrintHistograms(bool reset);
+
+// Writes every thread's event ring as Chrome trace JSON. Call once the
+// traced threads are done. Returns false if path could not be written.
+bool traceWriteChrome(const char *path);
+
+struct TraceScope
+{
+    TraceStage stage;
+    uint64_t start;
+    TraceScope(TraceStage s) : stage(s), start(traceNow()) {}
+    ~TraceScope() { traceRecord(stage, start, traceNow()); }
+};
+
+#define TRACE_CAT_(a, b) a##b
+#define TRACE_CAT(a, b) TRACE_CAT_(a, b)
+
+#if TRACE == 1
+#define TRACE_SCOPE(stage) TraceScope TRACE_CAT(trace_scope_, __LINE__)(stage) // Until the end of the block
+#define TRACE_BEGIN(t) uint64_t t = traceNow()
+#define TRACE_END(stage, t) traceRecord(stage, t, traceNow())
+#else
+#define TRACE_SCOPE(stage)
+#define TRACE_BEGIN(t)
+#define TRACE_END(stage, t)
+#endif
+
+#endif
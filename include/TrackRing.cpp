@@ -0,0 +1,122 @@
+#include <TrackRing.h>
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+static TrackRingShm *mapRing(int oflag, int prot)
+{
+    int fd = shm_open(TRACK_RING_NAME, oflag, 0644); // Readable by a GUI running as another user
+    if (fd < 0)
+    {
+        return nullptr;
+    }
+    if ((oflag & O_CREAT) && ftruncate(fd, sizeof(TrackRingShm)) != 0)
+    {
+        close(fd);
+        return nullptr;
+    }
+    void *p = mmap(NULL, sizeof(TrackRingShm), prot, MAP_SHARED, fd, 0);
+    close(fd);
+    return p == MAP_FAILED ? nullptr : (TrackRingShm *)p;
+}
+
+bool openTrackRingWriter(TrackRing &ring)
+{
+    ring = TrackRing();
+    shm_unlink(TRACK_RING_NAME); // Readers still mapping the last run's ring keep it to themselves
+    ring.shm = mapRing(O_RDWR | O_CREAT | O_EXCL, PROT_READ | PROT_WRITE);
+    if (ring.shm == nullptr)
+    {
+        fprintf(stderr, "Unable to create %s: %s\n", TRACK_RING_NAME, strerror(errno));
+        return false;
+    }
+    ring.writer = true;
+
+    memset((void *)ring.shm, 0, sizeof(TrackRingShm)); // Faults every page in, under mlockall() they stay
+    TrackRingHeader &h = ring.shm->header;
+    h.size = TRACK_RING_SIZE;
+    h.record_size = sizeof(TelemetryFrame);
+    h.head.store(0, std::memory_order_relaxed);
+    h.busy.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    h.magic = TRACK_RING_MAGIC; // Last, readers check it before anything else
+    return true;
+}
+
+bool openTrackRingReader(TrackRing &ring)
+{
+    ring = TrackRing();
+    ring.shm = mapRing(O_RDONLY, PROT_READ);
+    if (ring.shm != nullptr && ring.shm->header.magic != TRACK_RING_MAGIC)
+    {
+        closeTrackRing(ring);
+    }
+    return ring.shm != nullptr;
+}
+
+void writeTrack(TrackRing &ring, const TelemetryFrame &record)
+{
+    if (ring.shm == nullptr)
+    {
+        return;
+    }
+    TrackRingHeader &h = ring.shm->header;
+    uint32_t head = h.head.load(std::memory_order_relaxed);
+
+    // Claim the slot before the first byte of it changes. A release store
+    // alone would let the record's plain stores overtake it on ARM.
+    h.busy.store(head + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    ring.shm->records[head & (TRACK_RING_SIZE - 1)] = record;
+    h.head.store(head + 1, std::memory_order_release);
+}
+
+uint32_t trackHead(const TrackRing &ring)
+{
+    return ring.shm->header.head.load(std::memory_order_acquire);
+}
+
+bool readTrack(const TrackRing &ring, uint32_t &cursor, TelemetryFrame &record, long &lost)
+{
+    const TrackRingHeader &h = ring.shm->header;
+    uint32_t head = h.head.load(std::memory_order_acquire);
+    if (head - cursor > TRACK_RING_SIZE)
+    {
+        lost += head - cursor - TRACK_RING_SIZE;
+        cursor = head - TRACK_RING_SIZE;
+    }
+    while (cursor != head)
+    {
+        record = ring.shm->records[cursor & (TRACK_RING_SIZE - 1)];
+        std::atomic_thread_fence(std::memory_order_acquire);
+
+        // Whole unless the writer had started on record cursor + TRACK_RING_SIZE,
+        // which reuses the slot, by the time the copy was done
+        uint32_t busy = h.busy.load(std::memory_order_relaxed);
+        if (busy - cursor <= TRACK_RING_SIZE)
+        {
+            cursor++;
+            return true;
+        }
+        lost++;
+        cursor++;
+    }
+    return false;
+}
+
+void closeTrackRing(TrackRing &ring)
+{
+    if (ring.shm != nullptr)
+    {
+        munmap(ring.shm, sizeof(TrackRingShm));
+        if (ring.writer)
+        {
+            shm_unlink(TRACK_RING_NAME);
+        }
+    }
+    ring = TrackRing();
+}
@@ -0,0 +1,70 @@
+#ifndef TRACK_RING_INCLUDED
+#define TRACK_RING_INCLUDED
+
+#include <stdint.h>
+#include <atomic>
+
+#include <Telemetry.h>
+
+#define TRACK_RING_NAME "/bairhockey_track" // shm_open() name, /dev/shm/bairhockey_track
+#define TRACK_RING_SIZE 4096                // Records, 45 s at 90 FPS, power of two
+#define TRACK_RING_MAGIC 0x4B435254         // "TRCK"
+
+/* Every frame's track record in shared memory, for viewers and loggers. The
+   telemetry socket only carries stats and commands.
+   main.cpp is the only writer and never waits on a reader. Readers keep
+   their own cursor and can start any time; one that falls more than
+   TRACK_RING_SIZE records behind skips ahead and is told how many it lost.
+
+   The writer bumps busy before it touches a record and head once the
+   record is complete, the seqlock way round, so a reader that copied a
+   record and then finds busy has not lapped it knows the copy is whole.
+
+   Records are TelemetryFrame, see Telemetry.h for the Python struct format. The header is 32-bit so 32-bit readers load
+   head in one go; it wraps after 1.5 years at 90 FPS, which the unsigned
+   arithmetic handles. */
+
+struct TrackRingHeader
+{
+    uint32_t magic;
+    uint32_t size;              // Records, TRACK_RING_SIZE
+    uint32_t record_size;       // sizeof(TelemetryFrame)
+    std::atomic<uint32_t> head; // Records written, the newest is head - 1
+    std::atomic<uint32_t> busy; // Records started, head + 1 while one is being copied in
+    uint8_t pad[44];            // Records start on their own cache line
+};
+static_assert(sizeof(TrackRingHeader) == 64, "TrackRingHeader layout is shared with the GUI");
+
+struct TrackRingShm
+{
+    TrackRingHeader header;
+    TelemetryFrame records[TRACK_RING_SIZE];
+};
+
+struct TrackRing
+{
+    TrackRingShm *shm = nullptr;
+    bool writer = false;
+};
+
+// Creates the ring and faults its pages in, so writes never fault
+bool openTrackRingWriter(TrackRing &ring);
+
+// Maps an existing ring read only. Returns false if main.cpp has not made one.
+bool openTrackRingReader(TrackRing &ring);
+
+// Appends a record, wait-free
+void writeTrack(TrackRing &ring, const TelemetryFrame &record);
+
+// Records written so far, the cursor for a reader that only wants new ones
+uint32_t trackHead(const TrackRing &ring);
+
+// Copies the record at cursor into record and advances cursor. Returns false
+// if there is no new record. lost counts records overwritten before they
+// were read.
+bool readTrack(const TrackRing &ring, uint32_t &cursor, TelemetryFrame &record, long &lost);
+
+// Unmaps the ring, and removes it if this was the writer
+void closeTrackRing(TrackRing &ring);
+
+#endif
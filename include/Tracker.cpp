@@ -0,0 +1,31 @@
+#include <Tracker.h>
+#include <Table.h>
+
+using namespace cv;
+
+PuckState forwardPredict(PuckState s, float dt)
+{
+    s.pos += s.vel * dt;
+
+    // Reflect about the wall, same as (1+k)min - kx in trajectory_testing
+    if (s.pos.x < X_MIN)
+    {
+        s.pos.x = X_MIN + WALL_RESTITUTION * (X_MIN - s.pos.x);
+        s.vel.x = -WALL_RESTITUTION * s.vel.x;
+    }
+    else if (s.pos.x > X_MAX)
+    {
+        s.pos.x = X_MAX - WALL_RESTITUTION * (s.pos.x - X_MAX);
+        s.vel.x = -WALL_RESTITUTION * s.vel.x;
+    }
+    return s;
+}
+
+float interceptX(const PuckState &s, float y)
+{
+    if (s.vel.y == 0)
+    {
+        return NAN;
+    }
+    return s.pos.x + s.vel.x * (y - s.pos.y) / s.vel.y;
+}
@@ -0,0 +1,19 @@
+#ifndef TRACKER_INCLUDED
+#define TRACKER_INCLUDED
+
+#include <opencv2/opencv.hpp>
+
+struct PuckState
+{
+    cv::Point2f pos; // [px]
+    cv::Point2f vel; // [px/s]
+};
+
+// Moves the puck forward by dt seconds at constant velocity,
+// bouncing off the side walls at X_MIN and X_MAX.
+PuckState forwardPredict(PuckState s, float dt);
+
+// X position where the line of travel crosses y, NAN if moving parallel to it.
+float interceptX(const PuckState &s, float y);
+
+#endif
@@ -0,0 +1,202 @@
+#include <Vision.h>
+#include <Trace.h>
+
+using namespace std;
+using namespace cv;
+
+// const Point2f TABLE_CORNERS[4] = {Point2f(189, 37), Point2f(361, 37), Point2f(424, 299), Point2f(121, 299)};
+const Point2f TABLE_CORNERS[4] = {Point2f(88, 16), Point2f(174, 16), Point2f(204, 147), Point2f(54, 147)};
+// const Point2f DESIRED_CORNERS[4] = {Point2f(200, 100), Point2f(400, 100), Point2f(400, 400), Point2f(200, 400)};
+const Point2f DESIRED_CORNERS[4] = {Point2f(100, 50), Point2f(200, 50), Point2f(200, 200), Point2f(100, 200)};
+
+Mat tableHomography()
+{
+    vector<Point2f> table_corners(TABLE_CORNERS, TABLE_CORNERS + 4);
+    vector<Point2f> desired_corners(DESIRED_CORNERS, DESIRED_CORNERS + 4);
+    return findHomography(table_corners, desired_corners); // Generate perspective transformation matrix
+}
+
+void allocVisionBuffers(VisionBuffers &buf)
+{
+    buf.frame.create(FRM_ROWS, FRM_COLS, CV_8UC3);
+    buf.warped.create(WARP_ROWS, WARP_COLS, CV_8UC3);
+    buf.table = buf.warped(ROI_2);
+    buf.mask.create(ROI_2.height, ROI_2.width, CV_8UC1);
+    buf.filtered.create(ROI_2.height, ROI_2.width, CV_8UC1);
+    buf.marks.create(ROI_2.height + 2, ROI_2.width + 2, CV_8UC1);
+    buf.fill.reserve(ROI_2.area());
+}
+
+bool findPuck(VisionBuffers &buf, const Mat &homography, Point2f &puck_center, const PuckGate &gate)
+{
+    TRACE_BEGIN(t_warp);
+    warpTable(buf, homography);
+    TRACE_END(TRACE_WARP, t_warp);
+
+    TRACE_BEGIN(t_threshold);
+    thresholdTable(buf);
+    filterMask(buf);
+    TRACE_END(TRACE_THRESHOLD, t_threshold);
+
+    TRACE_SCOPE(TRACE_BLOBS); // Through the centroid
+    findBlobs(buf);
+    return selectPuck(buf, puck_center, gate);
+}
+
+void warpTable(VisionBuffers &buf, const Mat &homography)
+{
+    warpPerspective(buf.frame(ROI_1), buf.warped, homography, Size(WARP_COLS, WARP_ROWS));
+}
+
+void thresholdTable(VisionBuffers &buf)
+{
+    // normalize(src, src, 0, 255, NORM_MINMAX); // $$$
+    inRange(buf.table, PUCK_LOWERB, PUCK_UPPERB, buf.mask);
+}
+
+void filterMask(VisionBuffers &buf)
+{
+    medianBlur(buf.mask, buf.filtered, 5); // $$, not in place, that would copy the input first
+    // morphologyEx(thresh, thresh, MORPH_OPEN, getStructuringElement(MORPH_RECT, Size(5, 5)));
+    // blur(thresh, thresh, Size(5, 5));
+    // inRange(thresh, 100, 255);
+}
+
+bool puckSized(const Blob &blob, const PuckGate &gate)
+{
+    const Rect &rect = blob.box;
+    float peri = blob.perimeter;
+    return rect.width >= gate.min_width && rect.width <= gate.max_width &&
+           rect.height >= gate.min_height && rect.height <= gate.max_height &&
+           peri >= gate.min_perimeter && peri <= gate.max_perimeter;
+}
+
+bool selectPuck(const VisionBuffers &buf, Point2f &puck_center, const PuckGate &gate)
+{
+    for (int i = 0; i < buf.blob_count; i++)
+    {
+        // cout << buf.blobs[i].box << "\t" << buf.blobs[i].perimeter << "\n";
+
+        if (puckSized(buf.blobs[i], gate))
+        {
+            puck_center = puckCentroid(buf.filtered, buf.blobs[i].box); // Sub-pixel centre from blob moments
+            return true;
+        }
+    }
+    return false;
+}
+
+/* Chain code directions with y down, E first and counterclockwise on screen,
+   the order findContours() traces in */
+static const int DIR_X[8] = {1, 1, 0, -1, -1, -1, 0, 1};
+static const int DIR_Y[8] = {0, -1, -1, -1, 0, 1, 1, 1};
+
+/* Length of a blob's outer boundary, traced from its first pixel in raster
+   order the way findContours() traces an outer border, so it comes out the
+   same as arcLength() of that contour. marks has a zero border, so every
+   neighbour can be read. */
+static float boundaryLength(const Mat &marks, Point p0)
+{
+    auto set = [&](Point p, int s) { return marks.at<uchar>(p.y + DIR_Y[s], p.x + DIR_X[s]) != 0; };
+
+    // First neighbour clockwise from the west, which is clear
+    int s = 4;
+    do
+    {
+        s = (s - 1) & 7;
+    } while (!set(p0, s) && s != 4);
+    if (s == 4)
+    {
+        return 0; // Single pixel
+    }
+
+    Point p1(p0.x + DIR_X[s], p0.y + DIR_Y[s]), p3 = p0;
+    int straight = 0, diagonal = 0; // Counted, a float sum drifts on long borders
+    while (true)
+    {
+        // Next boundary pixel counterclockwise from the one before
+        int k = 1;
+        while (k < 8 && !set(p3, (s + k) & 7))
+        {
+            k++;
+        }
+        s = (s + k) & 7;
+        Point p4(p3.x + DIR_X[s], p3.y + DIR_Y[s]);
+        (s & 1) ? diagonal++ : straight++;
+
+        if (p4 == p0 && p3 == p1)
+        {
+            return (float)(straight + diagonal * M_SQRT2);
+        }
+        p3 = p4;
+        s = (s + 4) & 7;
+    }
+}
+
+void findBlobs(VisionBuffers &buf)
+{
+    Mat &marks = buf.marks;
+    copyMakeBorder(buf.filtered, marks, 1, 1, 1, 1, BORDER_CONSTANT, Scalar(0));
+
+    const uchar UNSEEN = 255, SEEN = 1;
+    buf.blob_count = 0;
+    for (int y = 1; y < marks.rows - 1; y++)
+    {
+        for (int x = 1; x < marks.cols - 1; x++)
+        {
+            if (marks.at<uchar>(y, x) != UNSEEN)
+            {
+                continue;
+            }
+            if (buf.blob_count == MAX_BLOBS)
+            {
+                return;
+            }
+
+            Blob &blob = buf.blobs[buf.blob_count++];
+            blob.perimeter = boundaryLength(marks, Point(x, y));
+
+            // Flood fill the rest so it is not found again, taking the bounding box on the way
+            int x_min = x, x_max = x, y_min = y, y_max = y;
+            marks.at<uchar>(y, x) = SEEN;
+            buf.fill.clear();
+            buf.fill.push_back(Point(x, y));
+            while (!buf.fill.empty())
+            {
+                Point p = buf.fill.back();
+                buf.fill.pop_back();
+                x_min = min(x_min, p.x);
+                x_max = max(x_max, p.x);
+                y_min = min(y_min, p.y);
+                y_max = max(y_max, p.y);
+                for (int s = 0; s < 8; s++)
+                {
+                    uchar &m = marks.at<uchar>(p.y + DIR_Y[s], p.x + DIR_X[s]);
+                    if (m == UNSEEN)
+                    {
+                        m = SEEN;
+                        buf.fill.push_back(Point(p.x + DIR_X[s], p.y + DIR_Y[s]));
+                    }
+                }
+            }
+            blob.box = Rect(x_min - 1, y_min - 1, x_max - x_min + 1, y_max - y_min + 1); // Back out of the border
+        }
+    }
+}
+
+Point2f puckCentroid(const Mat &mask, const Rect &blob)
+{
+    // Grow the blob box by CENTROID_PAD and clip it to the image
+    Rect window(blob.x - CENTROID_PAD, blob.y - CENTROID_PAD,
+                blob.width + 2 * CENTROID_PAD, blob.height + 2 * CENTROID_PAD);
+    window &= Rect(0, 0, mask.cols, mask.rows);
+
+    Moments m = moments(mask(window), true); // Binary moments, every set pixel has weight 1
+    if (m.m00 <= 0)
+    {
+        return Point2f(blob.x + (blob.width - 1) * 0.5f, blob.y + (blob.height - 1) * 0.5f);
+    }
+
+    // First order moments over area give the centroid relative to the window
+    return Point2f(window.x + (float)(m.m10 / m.m00), window.y + (float)(m.m01 / m.m00));
+}
@@ -0,0 +1,103 @@
+#ifndef VISION_INCLUDED
+#define VISION_INCLUDED
+
+#include <opencv2/opencv.hpp>
+#include <vector>
+
+/***************Camera and frame capture configuration******************/
+#define FRM_COLS 320
+#define FRM_ROWS 240
+#define FRM_RATE 90
+/*******************************************************/
+
+/*************** THRESHOLDING AND CROPPING SETUP ****************/
+const cv::Scalar PUCK_LOWERB(0, 0, 50);                // Lower bound for thresholding (BGR)
+const cv::Scalar PUCK_UPPERB(40, 40, 160);             // Upper bound for thresholding (BGR)
+const cv::Rect ROI_1(28, 14, 257, 206);                // Initial crop
+const cv::Rect ROI_2(77, 14, 225 - 77, 235 - 14);      // Crop after perspective correction
+#define WARP_COLS 230                                  // Perspective corrected image size
+#define WARP_ROWS 250
+/*******************************************************/
+
+#define MAX_BLOBS 64 // Blobs looked at per frame, any more are ignored
+
+/* Which blobs count as the puck, by bounding box and perimeter in the
+   corrected table. tools/accuracy_bench scores other settings against
+   annotated frames. */
+struct PuckGate
+{
+    int min_width = 10, max_width = 19;
+    int min_height = 6, max_height = 16;
+    float min_perimeter = 32, max_perimeter = 48;
+};
+
+/* Pixels added on each side of the bounding box before taking moments,
+   so edge pixels trimmed by the median filter still contribute. */
+#ifndef CENTROID_PAD
+#define CENTROID_PAD 2
+#endif
+
+// Actual table corners in the ROI_1 crop (trapezoidal) and where the
+// perspective correction puts them (rectangular)
+extern const cv::Point2f TABLE_CORNERS[4];
+extern const cv::Point2f DESIRED_CORNERS[4];
+
+// Perspective transformation from the ROI_1 crop to the corrected table
+cv::Mat tableHomography();
+
+struct Blob
+{
+    cv::Rect box;    // Bounding box in the corrected table image
+    float perimeter; // Outer boundary length, as arcLength() of its contour
+};
+
+/* Every per-frame image and list, allocated once by allocVisionBuffers()
+   so the loop never touches the heap. OpenCV only reallocates an output
+   whose size or type changes, and these never do. */
+struct VisionBuffers
+{
+    cv::Mat frame;               // Camera frame, FRM_COLS x FRM_ROWS BGR
+    cv::Mat warped;              // Perspective corrected ROI_1 crop of frame
+    cv::Mat table;               // ROI_2 view into warped, no data of its own
+    cv::Mat mask;                // table thresholded
+    cv::Mat filtered;            // mask after the median filter
+    cv::Mat marks;               // filtered with a zero border, blob pixels marked once visited
+    std::vector<cv::Point> fill; // Flood fill stack, capacity for the whole image
+    Blob blobs[MAX_BLOBS];
+    int blob_count = 0;
+};
+
+void allocVisionBuffers(VisionBuffers &buf);
+
+// Crops and corrects buf.frame, thresholds it and looks for a puck sized blob.
+// Returns true with its sub-pixel centre in the corrected table if one is found.
+bool findPuck(VisionBuffers &buf, const cv::Mat &homography, cv::Point2f &puck_center,
+              const PuckGate &gate = PuckGate());
+
+/* The stages findPuck() runs, in order. Each reads the buffer the one
+   before it wrote, so they can also be run and timed one at a time. */
+
+// buf.frame's ROI_1 crop, perspective corrected into buf.warped
+void warpTable(VisionBuffers &buf, const cv::Mat &homography);
+
+// buf.table's puck coloured pixels into buf.mask
+void thresholdTable(VisionBuffers &buf);
+
+// buf.mask median filtered into buf.filtered
+void filterMask(VisionBuffers &buf);
+
+// Fills buf.blobs with the 8-connected blobs of buf.filtered in raster order,
+// the outer borders findContours() finds, blobs inside another's hole included
+void findBlobs(VisionBuffers &buf);
+
+// First of buf.blobs that passes gate, and its centre
+bool selectPuck(const VisionBuffers &buf, cv::Point2f &puck_center, const PuckGate &gate = PuckGate());
+
+// Whether blob passes gate
+bool puckSized(const Blob &blob, const PuckGate &gate);
+
+// Sub-pixel puck centre from the binary moments of mask inside a small window around blob.
+// Falls back to the bounding box midpoint if the window holds no set pixels.
+cv::Point2f puckCentroid(const cv::Mat &mask, const cv::Rect &blob);
+
+#endif
@@ -6,39 +6,57 @@ using namespace cv;
 
 #include <wiringPi.h>
 #include <wiringSerial.h>
-#include <thread>
-#include <sys/mman.h> // Needed for mlockall()
-#include <unistd.h>   // needed for sysconf(int name);
-#include <malloc.h>
-#include <sys/time.h>     // needed for getrusage
-#include <sys/resource.h> // needed for getrusage
+#include <chrono>
+#include <unistd.h>
+#include <signal.h>
+
+#include <Table.h>
+#include <Vision.h>
+#include <Tracker.h>
+#include <Latency.h>
+#include <Strategy.h>
+#include <RTLib.h>
+#include <AllocTrack.h>
+#include <Trace.h>
+#include <FrameMonitor.h>
+#include <Telemetry.h>
+#include <TrackRing.h>
+#include <Recorder.h>
 
 /***************Camera and frame capture configuration******************/
-#define FRM_COLS 320
-#define FRM_ROWS 240
-#define FRM_RATE 90
-
-#define X_MIN 8
-#define Y_MIN 3
-#define X_MAX 139
-#define Y_MAX 200
-
-// Goal is between X = 42 and X = 103
-#define GOAL_MIN_X 38
-#define GOAL_MAX_X 108
-
-#define PUCK_HOME 68
-
 // Initialize image matrices
-Mat src(FRM_ROWS, FRM_COLS, CV_8UC3, Scalar(0, 0, 0)); // 8 bit, 3 channel
-Mat thresh(FRM_ROWS, FRM_COLS, CV_8UC1, Scalar(0));    // 8 bit, 1 channel
-vector<vector<Point>> contours;                        // Vector of integer vectors for contours
+VisionBuffers vision; // Every per-frame image, allocated once in main()
 
 VideoCapture cam(0); // Camera object
+FrameMonitor frame_monitor; // Frame drops and deadline misses
+Telemetry telemetry;        // Puck state to the GUI and commands back, see Telemetry.h
+TrackRing track_ring;       // Every frame's TelemetryFrame in shared memory, see TrackRing.h
+Recorder recorder;          // Session log for tools/replay, see Recorder.h
+
+#define CAPTURE_RETRY_MS 100     /* Wait between reads once the camera fails, instead of spinning the loop's core */
+#define CAPTURE_FAILURES_MAX 50  /* Failed reads in a row before the loop gives up, 5 s */
 /* ****************************************************************/
 
 /* *********************************Memory configuration***********************/
-#define PRE_ALLOCATION_SIZE 10 * 1000 * 1000 /* Size of pagefault free buffer in bytes */
+#define FAULT_AUDIT_FRAMES 900 /* Check the loop took no page faults or allocations every 10 s */
+#define ALLOC_STRICT 0         /* 1 to abort on any heap allocation in the loop after the warm-up */
+/* *************************************************************************/
+
+/* *********************************Session recording***********************/
+#define RECORD 1 /* Log every frame's crop and decisions to REC_DIR, see Recorder.h */
+/* *************************************************************************/
+
+/* *********************************Core placement***********************/
+#define ISOLATE 1 /* Loop and its IRQs on an isolcpus= core if the kernel has one, see RTLib.h */
+/* *************************************************************************/
+
+/* *********************************Tracing configuration***********************/
+#define TRACE_STATS 1  /* Print per-stage latency percentiles every FAULT_AUDIT_FRAMES frames, see Trace.h */
+#define TRACE_CHROME 0 /* 1 to write TRACE_FILE on Ctrl-C, open it in chrome://tracing or ui.perfetto.dev */
+#define TRACE_FILE "trace.json"
+
+volatile sig_atomic_t stop = 0; // Set by Ctrl-C, the loop finishes its frame and returns
+void onSigint(int) { stop = 1; }
 /* *************************************************************************/
 
 /* **************************Image processing configuration***************************/
@@ -46,10 +64,7 @@ Mat homography_matrix(3, 3, CV_8UC1, Scalar(0)); // 3 x 3, 8 bit, 1 channel
 /* *****************************************************************************/
 
 /* ********************Function prototypes************************************/
-void setMaxPriority(pid_t pid); // Sets thread FIFO priority high
-// Shows pagefaults generated when accessing memory space
-void showNewPageFaultCount(const char *logtext, const char *allowed_maj, const char *allowed_min);
-void reserveProcessMemory(int size); // "Touches" memory space of size
+bool waitForGantry(int fd, int timeout_s); // Waits for the PSoC to finish homing
 /* ***********************************************************************/
 
 /************** MAIN FUNCTION ***************/
@@ -58,52 +73,16 @@ int main()
     /************* MEMORY CONFIGURATION ****************/
     printf("\nMemory configuration:\n");
 
-    pid_t primary_pid = getpid();
-    setMaxPriority(primary_pid);
-
-    /* Now lock all current and future pages from preventing of being paged */
-    if (mlockall(MCL_CURRENT | MCL_FUTURE))
-        perror("mlockall failed");
-
-    /* Turn off malloc trimming.*/
-    mallopt(M_TRIM_THRESHOLD, -1);
-
-    /* Turn off mmap usage. */
-    mallopt(M_MMAP_MAX, 0);
-
-    showNewPageFaultCount("mlockall() generated", ">=0", ">=0");
+    showNewPageFaultCount("Startup generated", ">=0", ">=0");
 
-    reserveProcessMemory(PRE_ALLOCATION_SIZE);
-
-    showNewPageFaultCount("malloc() and touch generated",
-                          ">=0", ">=0");
-
-    /* Now allocate the memory for the 2nd time and prove the number of pagefaults is zero */
-    reserveProcessMemory(PRE_ALLOCATION_SIZE);
-    showNewPageFaultCount("2nd malloc() and use generated",
-                          "0", "0");
-
-    printf("Look at the output of ps -leyf, and see that the "
-           "RSS is now about %d [kB]\n",
-           PRE_ALLOCATION_SIZE / (1000));
+    lockProcessMemory(RT_HEAP_RESERVE); // For OpenCV's worker threads, see RTLib.h
+    allocVisionBuffers(vision);
+#if RECORD == 1
+    startRecorder(recorder, REC_DIR); // Slots allocated and locked here, not in the loop
+#endif
+    showNewPageFaultCount("mlockall() and buffers generated", ">=0", ">=0");
     /*******************************************************/
 
-    /***************** CPU CONFIGURATION ********************/
-    printf("\nCPU Configuration:\n");
-    cpu_set_t mask;
-    CPU_ZERO(&mask);   // Set CPU core usage of program to zero
-    CPU_SET(0, &mask); // Set usage on core 0
-    CPU_SET(1, &mask); // Set usage on core 1
-    CPU_SET(2, &mask); // Set usage on core 2
-    CPU_SET(3, &mask); // Set usage on core 3
-    cout << "CPU affinity set to: ";
-    for (int i = 0; i < 4; i++)
-    {
-        cout << CPU_ISSET(i, &mask) << " "; // Verify CPU usage
-    }
-    cout << "\n";
-    sched_setaffinity(primary_pid, sizeof(mask), &mask); // Update CPU core usage
-
     printf("\nCamera configration:\n");
     cam.set(CAP_PROP_FRAME_WIDTH, FRM_COLS);  // Set frame width
     cam.set(CAP_PROP_FRAME_HEIGHT, FRM_ROWS); // Set frame height
@@ -111,36 +90,28 @@ int main()
 
     cam.set(CAP_PROP_FPS, FRM_RATE); // Set nominal frame rate.
     printf("Camera nominal frame rate: %d\n", FRM_RATE);
+    initFrameMonitor(frame_monitor, cam, FRM_RATE);
     /*******************************************************/
 
     /************** PERSPECTIVE CORRECTION SETUP ********************/
-    vector<Point2f> table_corners(4); // Actual table corners (trapezoidal)
-    // Point2f table_corners_pixels[4] = {Point2f(189, 37), Point2f(361, 37), Point2f(424, 299), Point2f(121, 299)};
-    Point2f table_corners_pixels[4] = {Point2f(88, 16), Point2f(174, 16), Point2f(204, 147), Point2f(54, 147)};
-
-    vector<Point2f> desired_corners(4); // Desried table corners (rectangular)
-    // Point2f desired_corners_pixels[4] = {Point2f(200, 100), Point2f(400, 100), Point2f(400, 400), Point2f(200, 400)};
-    Point2f desired_corners_pixels[4] = {Point2f(100, 50), Point2f(200, 50), Point2f(200, 200), Point2f(100, 200)};
-
-    // Set table_corners and desried_corners value to those in *pixels
-    // Written this way for neatness...
     for (int i = 0; i < 4; i++)
     {
-        table_corners[i] = table_corners_pixels[i];
-        desired_corners[i] = desired_corners_pixels[i];
-        cout << "Table Corner: " << table_corners[i] << "\tDesired Corner: " << desired_corners[i] << "\n";
+        cout << "Table Corner: " << TABLE_CORNERS[i] << "\tDesired Corner: " << DESIRED_CORNERS[i] << "\n";
     }
 
-    homography_matrix = findHomography(table_corners, desired_corners); // Generate perspective transformation matrix
+    homography_matrix = tableHomography(); // Generate perspective transformation matrix
     cout << "Generated Homography Matrix:\n"
          << homography_matrix << "\n\n";
     /*******************************************************/
 
-    /*************** THRESHOLDING AND CROPPING SETUP ****************/
-    Scalar lowerb = Scalar(0, 0, 50);              // Lower bound for thresholding
-    Scalar upperb = Scalar(40, 40, 160);           // Upper bound for thresholding
-    Rect roi_1 = Rect(28, 14, 257, 206);           // Initial crop
-    Rect roi_2 = Rect(77, 14, 225 - 77, 235 - 14); // Crop after perspective correction
+    /******************** LATENCY MODEL SETUP *********************/
+    LatencyModel latency_model;
+    if (!loadLatencyModel(LATENCY_CFG, latency_model))
+    {
+        printf("No %s, using default latency model\n", LATENCY_CFG);
+    }
+    printLatencyModel(latency_model);
+    float latency = totalLatency(latency_model); // Forward prediction horizon [s]
     /*******************************************************/
 
     /****************** IMAGE DISPLAY SETUP ******************/
@@ -164,10 +135,22 @@ int main()
         return 1;
     }
 
+    // The GUI talks to us rather than to the UART, which is left to the motor link
+    if (!openTelemetry(telemetry))
+    {
+        printf("No telemetry, running without the GUI\n");
+    }
+    openTrackRingWriter(track_ring);
+
+    // The PSoC homes the gantry at power on and ignores targets until it is done
+    if (!waitForGantry(fd, 30))
+    {
+        printf("Gantry not homed, carrying on anyway\n");
+    }
+
     /*************** BEHAVIOR *****************/
-    // short int difficulty = 0; //[0, 1, 2] = [Easy, Medium, Hard]
-    // short int state = 0;      //[0, 1, 2, 3, 4] = [Wait, Catch, Bank Left, Straight, Bank Right]
-    // float v_x_0, v_y_0;
+    // State machine and per-difficulty parameters live in Strategy.cpp
+    Strategy strategy;
 
     /*************** MAIN LOOP ****************/
     printf("\nProgram started...\n");
@@ -175,176 +158,196 @@ int main()
     auto t_1 = chrono::steady_clock::now(); // Initialize timer
 
     // Initialize prediction variables
-    float x_0, y_0, x_1, y_1, x_2, y_2;
-    float v_y;
+    float x_0 = 0, y_0 = 0, x_1 = 0, y_1 = 0, x_2 = 0, y_2 = 0;
+    float v_x, v_y;
 
     int8_t coord[4];
 
     int difficulty = 1;
     bool run = 1;
 
-    int8_t recv_buf;
-
-    while (true)
+    /************* PIPELINE THREAD ****************/
+    // SCHED_FIFO at the top priority with a prefaulted stack, see RTLib.h
+    RtThreadConfig loop_config;
+    loop_config.name = "vision";
+    loop_config.priority = sched_get_priority_max(SCHED_FIFO);
+#if ISOLATE == 1
+    // Frames and serial replies are handled on the core that takes their interrupts
+    loop_config.cpu = isolatedCpu();
+    if (loop_config.cpu >= 0)
     {
-        // printf("%d", waiting);
-        if (run)
+        int camera_irqs = moveIrqs(RT_CAMERA_IRQS, loop_config.cpu);
+        int uart_irqs = moveIrqs(RT_UART_IRQS, loop_config.cpu);
+        printf("Isolated cpu %d: %d camera and %d UART IRQs moved to it\n", loop_config.cpu, camera_irqs, uart_irqs);
+    }
+    else
+    {
+        printf("No isolated cpu (boot with isolcpus= nohz_full=), the loop shares every core\n");
+    }
+#endif
+
+    signal(SIGINT, onSigint);
+
+    pthread_t loop_thread;
+    bool started = startRtThread(loop_thread, loop_config, [&] {
+        PageFaults faults_0 = threadPageFaults();
+        long frames = 0, allocs = 0;
+        int capture_failures = 0; // Failed reads in a row
+
+        // Control bytes from the GUI
+        auto command = [&](int cmd) {
+            if (cmd == 0)
+            {
+                return;
+            }
+            printf("command: %c\n", cmd);
+            switch (cmd)
+            {
+            case CMD_EASY:
+                difficulty = 0;
+                break;
+            case CMD_MEDIUM:
+                difficulty = 1;
+                break;
+            case CMD_HARD:
+                difficulty = 2;
+                break;
+            case CMD_RUN:
+                run = 1;
+                strategy = Strategy();
+                break;
+            case CMD_STOP:
+                run = 0;
+                break;
+            }
+        };
+
+        while (!stop)
         {
-            cam.read(src);
-            src = src(roi_1);
-            warpPerspective(src, src, homography_matrix, Size(230, 250));
-            src = src(roi_2);
-
-            // normalize(src, src, 0, 255, NORM_MINMAX); // $$$
-            inRange(src, lowerb, upperb, thresh);
-            medianBlur(thresh, thresh, 5); // $$
-            // morphologyEx(thresh, thresh, MORPH_OPEN, getStructuringElement(MORPH_RECT, Size(5, 5)));
-            // blur(thresh, thresh, Size(5, 5));
-            // inRange(thresh, 100, 255);
-
-            findContours(thresh, contours, RETR_TREE, CHAIN_APPROX_SIMPLE, Point(0, 0));
-            Point puck_center;
-            bool waiting = 0;
-            bool finding = 1;
-
-            if (contours.size() > 0)
+            // printf("%d", waiting);
+            if (run)
             {
-                for (uint8_t i = 0; i < contours.size(); i++)
-                {
-                    Rect rect = boundingRect(contours[i]);
-                    double peri = arcLength(contours[i], 1);
+                allocs += allocTrackEnd(); // Over the last frame
 
-                    // cout << rect << "\t" << peri << "\n";
+                // Steady state should not fault or allocate, the first window is the warm-up
+                if (++frames % FAULT_AUDIT_FRAMES == 0)
+                {
+                    PageFaults faults = threadPageFaults();
+                    if (frames == FAULT_AUDIT_FRAMES || faults.major != faults_0.major || faults.minor != faults_0.minor || allocs != 0)
+                    {
+                        printf("Loop over %d frames%s: Pagefaults Major:%ld Minor:%ld, Allocations:%ld\n",
+                               FAULT_AUDIT_FRAMES, frames == FAULT_AUDIT_FRAMES ? " (warm-up)" : "",
+                               faults.major - faults_0.major, faults.minor - faults_0.minor, allocs);
+                    }
+                    const FrameStats &fs = frame_monitor.stats;
+                    TelemetryStats stats;
+                    stats.frames = fs.frames, stats.dropped = fs.dropped, stats.skipped = fs.skipped;
+                    stats.repeated = fs.repeated, stats.misses = fs.misses, stats.worst_ms = fs.worst_ms;
+                    stats.allocs = allocs;
+                    stats.faults_major = faults.major - faults_0.major;
+                    stats.faults_minor = faults.minor - faults_0.minor;
+                    publishTelemetry(telemetry, &stats, sizeof(stats));
+
+                    faults_0 = faults;
+                    allocs = 0;
+                    printFrameStats(frame_monitor.stats, "Frames");
+                    frame_monitor.stats = FrameStats();
+#if TRACE_STATS == 1
+                    tracePrintHistograms(true);
+#endif
+                }
+                allocTrackBegin(ALLOC_STRICT && frames > FAULT_AUDIT_FRAMES);
+                TRACE_SCOPE(TRACE_FRAME); // To the end of the block, leaving out the audit printing
 
-                    if (rect.width >= 10 && rect.width <= 19 && rect.height >= 6 && rect.height <= 16 && peri >= 32 && peri <= 48)
+                TRACE_BEGIN(t_capture);
+                bool grabbed = readNewest(cam, frame_monitor, vision.frame); // Skips frames we fell behind on
+                TRACE_END(TRACE_CAPTURE, t_capture);
+                if (!grabbed)
+                {
+                    // Unplugged or EIO. Back off, still taking commands, and stop if it stays gone.
+                    if (++capture_failures >= CAPTURE_FAILURES_MAX)
                     {
-                        finding = 0;
-                        bool tracking = 1;
-                        puck_center = Point(rect.x + rect.width / 2, rect.y + rect.height / 2);
+                        fprintf(stderr, "Camera read failed %d times in a row, stopping\n", capture_failures);
+                        stop = 1;
+                    }
+                    else
+                    {
+                        if (capture_failures == 1)
+                        {
+                            fprintf(stderr, "Camera read failed, retrying\n");
+                        }
+                        command(pollTelemetry(telemetry, CAPTURE_RETRY_MS));
+                    }
+                    continue;
+                }
+                capture_failures = 0;
 
-                        // circle(src, puck_center, 2, Scalar(0, 255, 0), -1, 8, 0);
+                Point2f puck_center;
+                bool waiting = 0;
+                TelemetryFrame telem = TelemetryFrame();
 
-                        // Current point x_1, y_1
-                        x_2 = puck_center.x, y_2 = puck_center.y;
+                // What the frame starts from, so replay can run it on its own
+                RecordHeader record;
+                record.x_0 = x_0, record.y_0 = y_0, record.x_1 = x_1, record.y_1 = y_1;
+                record.latency = latency;
+                record.strategy_state = strategy.state;
+                record.threat_frames = strategy.threat_frames;
 
-                        auto t_2 = chrono::steady_clock::now();      // Update current time
-                        chrono::duration<float> t_delta = t_2 - t_0; // Update t_delta
-                        t_0 = t_1;                                   // Update past time
-                        t_1 = t_2;
-                        // printf("Time between captures: %.3fms.\n", 1000 * t_delta.count());
+                if (findPuck(vision, homography_matrix, puck_center))
+                {
+                    bool tracking = 1;
 
-                        // v_x = (x_1 - x_0) / t_delta.count();
-                        v_y = (y_2 - y_0) / t_delta.count();
+                    // circle(src, puck_center, 2, Scalar(0, 255, 0), -1, 8, 0);
 
-                        // Puck goes from
-                        // X = 8 to X = 139
-                        // Y = 3 to Y = 180 (limit of camera vision, not end of table)
-                        // Middle of table is X = 70 Y = 112
-                        tracking = 0;
-                        bool predicting = 1;
-                        float x_pred = x_0 + (x_2 - x_0) * (Y_MAX - y_0) / (y_2 - y_0);
-                        float y_pred = Y_MAX;
+                    // Current point x_1, y_1
+                    x_2 = puck_center.x, y_2 = puck_center.y;
 
-                        x_0 = x_1, y_0 = y_1; // Update past point
-                        x_1 = x_2, y_1 = y_2;
+                    auto t_2 = chrono::steady_clock::now();      // Update current time
+                    chrono::duration<float> t_delta = t_2 - t_0; // Update t_delta
+                    t_0 = t_1;                                   // Update past time
+                    t_1 = t_2;
+                    // printf("Time between captures: %.3fms.\n", 1000 * t_delta.count());
 
-                        // cout << v_y << "\n";
-                        // cout << x_pred << "\t" << y_pred << "\n";
+                    record.t_delta = t_delta.count();
+                    v_x = (x_2 - x_0) / t_delta.count();
+                    v_y = (y_2 - y_0) / t_delta.count();
 
-                        // line(src, Point(x_1, y_1), Point(x_pred, y_pred), Scalar(255, 255, 0), 1, LINE_8);
+                    tracking = 0;
+                    bool predicting = 1;
+                    TRACE_BEGIN(t_predict);
+                    // Plan against where the puck will be when the motors respond
+                    PuckState puck = forwardPredict({Point2f(x_2, y_2), Point2f(v_x, v_y)}, latency);
+                    float x_pred = interceptX(puck, Y_MAX);
+                    float y_pred = Y_MAX;
+                    telem.found = 1;
+                    telem.puck_x = x_2, telem.puck_y = y_2;
+                    telem.v_x = v_x, telem.v_y = v_y;
+                    telem.x_pred = x_pred;
 
-                        // cout << puck_center.x << "\t" << puck_center.y << "\n";
+                    x_0 = x_1, y_0 = y_1; // Update past point
+                    x_1 = x_2, y_1 = y_2;
 
-                        switch (difficulty)
-                        {
-                        case 0:
-#define EASY_DELTA 40
-                            if (y_2 > 80 && v_y > 0)
-                            {
-                                if (x_pred >= GOAL_MIN_X - 5 && x_pred <= 65)
-                                {
-                                    coord[0] = PUCK_HOME - EASY_DELTA;
-                                    coord[1] = 0;
-                                }
-                                else if (x_pred <= GOAL_MAX_X + 5 && x_pred >= 75)
-                                {
-                                    coord[0] = PUCK_HOME + EASY_DELTA;
-                                    coord[1] = 0;
-                                }
-                                else
-                                {
-                                    coord[0] = PUCK_HOME;
-                                    coord[1] = 0;
-                                }
-                            }
-                            else
-                            {
-                                waiting = 1;
-                            }
-                            break;
-                        case 1:
-#define MED_DELTA 20
-                            if (y_2 > 80 && v_y > 0)
-                            {
-                                if (x_pred >= GOAL_MIN_X - 30 && x_pred <= 65)
-                                {
-                                    coord[0] = PUCK_HOME - MED_DELTA;
-                                    coord[1] = 0;
-                                }
-                                else if (x_pred <= GOAL_MAX_X + 30 && x_pred >= 75)
-                                {
-                                    coord[0] = PUCK_HOME + MED_DELTA;
-                                    coord[1] = 0;
-                                }
-                                else
-                                {
-                                    coord[0] = PUCK_HOME;
-                                    coord[1] = 0;
-                                }
-                            }
-                            else
-                            {
-                                waiting = 1;
-                            }
-                            break;
-                        case 2:
-#define HARD_DELTA 20
-#define HARD_Y 20
-                            if (y_2 > 80 && v_y > 0)
-                            {
-                                if (x_pred >= GOAL_MIN_X - 30 && x_pred <= 65)
-                                {
-                                    coord[0] = PUCK_HOME - HARD_DELTA;
-                                    coord[1] = 20;
-                                }
-                                else if (x_pred <= GOAL_MAX_X + 30 && x_pred >= 75)
-                                {
-                                    coord[0] = PUCK_HOME + HARD_DELTA;
-                                    coord[1] = 20;
-                                }
-                                else
-                                {
-                                    coord[0] = PUCK_HOME;
-                                    coord[1] = HARD_Y;
-                                }
-                            }
-                            else
-                            {
-                                waiting = 1;
-                            }
-                            break;
-                        }
-                        break;
-                    }
-                    else
+                    // cout << v_y << "\n";
+                    // cout << x_pred << "\t" << y_pred << "\n";
+
+                    // line(src, Point(x_1, y_1), Point(x_pred, y_pred), Scalar(255, 255, 0), 1, LINE_8);
+
+                    // cout << puck_center.x << "\t" << puck_center.y << "\n";
+
+                    if (!strategyCommand(strategy, difficulty, puck, x_pred, coord))
                     {
                         waiting = 1;
                     }
+                    TRACE_END(TRACE_PREDICT, t_predict);
+                }
+                else
+                {
+                    waiting = 1;
                 }
 
 #if DISP_IMGS == 1
-                imshow("SRC", src);
-                imshow("THRESH", thresh);
+                imshow("SRC", vision.table);
+                imshow("THRESH", vision.filtered);
 
                 if (waitKey(10) == 27)
                 {
@@ -352,129 +355,88 @@ int main()
                     break;
                 }
 #endif
-            }
-            else
-            {
-                waiting = 1;
-            }
-            if (waiting)
-            {
-                coord[0] = PUCK_HOME;
-                coord[1] = 0;
-            }
 
-            coord[2] = x_2;
-            coord[3] = y_2;
-            // printf("%d\t%d\t%d\t%d\n", coord[0], coord[1], coord[2], coord[3]);
-            write(fd, &coord, 4);
+                commandPacket(coord, waiting, x_2, y_2);
+                // printf("%d\t%d\t%d\t%d\n", coord[0], coord[1], coord[2], coord[3]);
+                TRACE_BEGIN(t_uart);
+                write(fd, &coord, 4);
+                TRACE_END(TRACE_UART, t_uart);
+                frameDone(frame_monitor);
 
-            if (waiting)
-            {
-                // printf("%d\n", difficulty);
-                if (serialDataAvail(fd))
-                {
-                    // recv_buf = serialGetchar(fd);
-                    read(fd, &recv_buf, 1);
-                    printf("recv: %d\n", recv_buf);
-                    switch (recv_buf)
-                    {
-                    case 48:
-                        difficulty = 0;
-                        break;
-                    case 49:
-                        difficulty = 1;
-                        break;
-                    case 50:
-                        difficulty = 2;
-                        break;
-                    case 51:
-                        run = 1;
-                        break;
-                    case 52:
-                        run = 0;
-                        break;
-                    }
-                }
+                telem.waiting = waiting;
+                telem.difficulty = difficulty;
+                memcpy(telem.coord, coord, sizeof(coord));
+                telem.seq = frames;
+                telem.t_ns = traceNow();
+                writeTrack(track_ring, telem); // Viewers read it there, not off the socket
+                record.track = telem;
+                recordFrame(recorder, vision.frame, record);
+
+
+                command(pollTelemetry(telemetry, 0));
             }
-        }
-        else
-        {
-            if (serialDataAvail(fd))
+            else
             {
-                // recv_buf = serialGetchar(fd);
-                read(fd, &recv_buf, 1);
-                printf("recv: %d\n", recv_buf);
-                switch (recv_buf)
-                {
-                case 48:
-                    difficulty = 0;
-                    break;
-                case 49:
-                    difficulty = 1;
-                    break;
-                case 50:
-                    difficulty = 2;
-                    break;
-                case 51:
-                    run = 1;
-                    break;
-                case 52:
-                    run = 0;
-                    break;
-                }
+                command(pollTelemetry(telemetry, 100)); // Stopped, sleep until the GUI sends something
             }
-        }
 
-    } /************* END MAIN LOOP ****************/
+        } /************* END MAIN LOOP ****************/
+    });
+    if (!started)
+    {
+        fprintf(stderr, "Unable to start the vision thread\n");
+        return 1;
+    }
+    pthread_join(loop_thread, NULL);
+    closeTelemetry(telemetry);
+    closeTrackRing(track_ring);
+    stopRecorder(recorder);
+
+#if TRACE_CHROME == 1
+    if (traceWriteChrome(TRACE_FILE))
+    {
+        printf("Trace written to %s\n", TRACE_FILE);
+    }
+    else
+    {
+        fprintf(stderr, "Unable to write %s: %s\n", TRACE_FILE, strerror(errno));
+    }
+#endif
     return 0;
 }
 /*********** END MAIN FUNCTION *****************/
 
-void setMaxPriority(pid_t pid)
-{
-    struct sched_param sp;
-    sp.sched_priority = sched_get_priority_max(SCHED_FIFO);
-    sched_setscheduler(pid, SCHED_FIFO, &sp);
-    printf("PID: %d \t Priority: %d\n", pid, sp.sched_priority);
-}
-
-int last_majflt = 0, last_minflt = 0;
-void showNewPageFaultCount(const char *logtext, const char *allowed_maj, const char *allowed_min)
+bool waitForGantry(int fd, int timeout_s)
 {
-    struct rusage usage;
-    getrusage(RUSAGE_SELF, &usage);
-
-    printf("%-30.30s: Pagefaults, Major:%ld (Allowed %s), "
-           "Minor:%ld (Allowed %s)\n",
-           logtext,
-           usage.ru_majflt - last_majflt, allowed_maj,
-           usage.ru_minflt - last_minflt, allowed_min);
-
-    last_majflt = usage.ru_majflt;
-    last_minflt = usage.ru_minflt;
-}
-
-void reserveProcessMemory(int size)
-{
-    int i;
-    char *buffer;
-    buffer = (char *)malloc(size);
-
-    /* Touch each page in this piece of memory to get it mapped into RAM */
-    for (i = 0; i < size; i += sysconf(_SC_PAGESIZE))
+    const int8_t query[4] = {(int8_t)0xFF, 0x70, 0, 0}; // CMD_HOME, see psoc_code params.h
+    serialFlush(fd);
+    write(fd, query, 4);
+
+    // Replies with "homing" first if it is not done yet, then "ready" or "home failed"
+    string line;
+    auto t_end = chrono::steady_clock::now() + chrono::seconds(timeout_s);
+    while (chrono::steady_clock::now() < t_end)
     {
-        /* Each write to this buffer will generate a pagefault.
-		   Once the pagefault is handled a page will be locked in
-		   memory and never given back to the system. */
-        buffer[i] = 0;
+        int c = serialGetchar(fd); // -1 after 10 s of nothing
+        if (c < 0)
+        {
+            continue;
+        }
+        if (c != '\n')
+        {
+            line += (char)c;
+            continue;
+        }
+        printf("PSoC: %s\n", line.c_str());
+        if (line == "ready")
+        {
+            return true;
+        }
+        if (line == "home failed")
+        {
+            return false;
+        }
+        line.clear();
     }
-
-    /* buffer will now be released. As Glibc is configured such that it 
-	   never gives back memory to the kernel, the memory allocated above is
-	   locked for this process. All malloc() and new() calls come from
-	   the memory pool reserved and locked above. Issuing free() and
-	   delete() does NOT make this locking undone. So, with this locking
-	   mechanism we can build C++ applications that will never run into
-	   a major/minor pagefault, even with swapping enabled. */
-    free(buffer);
+    return false;
 }
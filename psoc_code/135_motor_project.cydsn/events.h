@@ -0,0 +1,20 @@
+#ifndef EVENTS_H
+#define EVENTS_H
+
+#include "project.h"
+
+/************* MAIN LOOP EVENTS **************
+Set by the ISRs, taken and cleared by the main loop, which sleeps (WFI)
+while none are pending.
+*******************************************/
+
+#define EVT_TARGET 0x01 // New target packet received
+#define EVT_RESET 0x02  // Home switch hit
+#define EVT_IDLE 0x04   // Planner queue ran empty
+#define EVT_PARAM 0x08  // Parameter command received
+
+extern volatile uint8 events;
+
+#define post_event(e) (events |= (e))
+
+#endif /* EVENTS_H */
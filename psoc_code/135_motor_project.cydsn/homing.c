@@ -0,0 +1,152 @@
+#include "homing.h"
+#include "stepper.h"
+#include "events.h"
+#include "params.h"
+
+int printf(const char *format, ...);
+
+typedef enum
+{
+    HOME_AWAY,
+    HOME_FAST,
+    HOME_BACK,
+    HOME_SLOW,
+    HOME_CLEAR,
+    HOME_DONE,
+    HOME_FAILED
+} home_state;
+
+static home_state state = HOME_FAILED; // Not homed until homing_start()
+static uint8 axis = 0;                 // 0 x, 1 y
+
+/* Moves d steps along the axis being homed, positive toward its switch
+   (-x or -y). In motor steps that is (d, d) for x and (-d, d) for y. */
+static void move(int32 d, float v)
+{
+    int32 m1, m2;
+    stepper_position(&m1, &m2);
+    stepper_retarget(m1 + (axis == 0 ? d : -d), m2 + d, v);
+}
+
+// Longest move that must reach the switch from anywhere on the axis [steps]
+static int32 travel(void)
+{
+    int16 spp = param[PARAM_STEPS_PER_PIXEL];
+    int16 span = axis == 0 ? param[PARAM_X_MAX] - param[PARAM_HOME_X] : param[PARAM_Y_MAX] - param[PARAM_HOME_Y];
+    return (int32)span * spp + 4 * HOME_BACKOFF;
+}
+
+// Sets the homed axis to its home position, keeping the other one
+static void latch(void)
+{
+    int32 m1, m2;
+    stepper_position(&m1, &m2);
+
+    // Doubled axis positions, x2 = 2x and y2 = 2y, so the sums stay whole
+    int32 x2 = -(m1 + m2), y2 = m1 - m2;
+    int16 spp = param[PARAM_STEPS_PER_PIXEL];
+    if (axis == 0)
+    {
+        x2 = 2 * param[PARAM_HOME_X] * spp;
+        y2 += y2 & 1; // Half a step out at worst, y is homed next
+    }
+    else
+    {
+        y2 = 2 * param[PARAM_HOME_Y] * spp;
+        x2 += x2 & 1;
+    }
+    stepper_set_position((y2 - x2) / 2, -(x2 + y2) / 2);
+}
+
+static void fail(void)
+{
+    state = HOME_FAILED;
+    stepper_set_position(0, 0); // Stop, it is lost anyway
+    printf("home failed\n");
+}
+
+void homing_start(void)
+{
+    int32 m1, m2;
+
+    printf("homing\n");
+    axis = 0;
+    state = HOME_AWAY;
+
+    // Off both switches diagonally, +x and +y
+    stepper_position(&m1, &m2);
+    stepper_retarget(m1, m2 - 2 * HOME_BACKOFF, HOME_SLOW_SPEED);
+}
+
+void homing_update(uint8 e)
+{
+    switch (state)
+    {
+    case HOME_AWAY:
+        if (!stepper_busy())
+        {
+            state = HOME_FAST;
+            move(travel(), HOME_FAST_SPEED);
+        }
+        break;
+    case HOME_FAST:
+        if (e & EVT_RESET)
+        {
+            // Brakes past the switch and comes back out behind it
+            state = HOME_BACK;
+            move(-HOME_BACKOFF, HOME_FAST_SPEED);
+        }
+        else if (!stepper_busy())
+        {
+            fail();
+        }
+        break;
+    case HOME_BACK:
+        if (!stepper_busy())
+        {
+            state = HOME_SLOW;
+            move(2 * HOME_BACKOFF, HOME_SLOW_SPEED);
+        }
+        break;
+    case HOME_SLOW:
+        if (e & EVT_RESET)
+        {
+            latch(); // Stops dead, fine at this speed
+            state = HOME_CLEAR;
+            move(-HOME_BACKOFF, HOME_SLOW_SPEED);
+        }
+        else if (!stepper_busy())
+        {
+            fail();
+        }
+        break;
+    case HOME_CLEAR:
+        if (!stepper_busy())
+        {
+            if (axis == 0)
+            {
+                axis = 1;
+                state = HOME_FAST;
+                move(travel(), HOME_FAST_SPEED);
+            }
+            else
+            {
+                state = HOME_DONE;
+                printf("ready\n");
+            }
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+uint8 homing_done(void)
+{
+    return state == HOME_DONE;
+}
+
+void homing_status(void)
+{
+    printf(state == HOME_DONE ? "ready\n" : state == HOME_FAILED ? "home failed\n" : "homing\n");
+}
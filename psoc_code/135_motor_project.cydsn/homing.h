@@ -0,0 +1,36 @@
+#ifndef HOMING_H
+#define HOMING_H
+
+#include "project.h"
+
+/************* HOMING **************
+Finds the absolute position at power on, before any target is accepted.
+The x and y limit switches are wired together onto Pin_1 (pos_reset), so
+the axes are homed one at a time, each backed off its switch before the
+next starts:
+    away   both axes off their switches, in case one starts closed
+    fast   toward the switch until it closes, braking past it
+    back   back off clear of the switch
+    slow   toward it again slowly, the position is latched when it closes
+    clear  back off again so the switch is open for the next axis
+The latched axis reads PARAM_HOME_X / Y. Prints "ready" when done, or
+"home failed" if a switch never closes.
+*******************************************/
+
+#define HOME_FAST_SPEED 1600.0f // Along the path [steps/s]
+#define HOME_SLOW_SPEED 160.0f  // Latching approach, about a step of overrun
+#define HOME_BACKOFF 32         // Along the axis [steps], must clear the switch hysteresis
+
+// Forgets the position and starts homing from wherever the gantry is
+void homing_start(void);
+
+// Steps the homing sequence on the main loop's events (EVT_*)
+void homing_update(uint8 e);
+
+// 1 once homed, targets are only followed then
+uint8 homing_done(void);
+
+// Prints ready, homing or home failed
+void homing_status(void);
+
+#endif /* HOMING_H */
@@ -0,0 +1,68 @@
+#ifndef MAILBOX_H
+#define MAILBOX_H
+
+#include <stdint.h>
+
+/************* TARGET MAILBOX **************
+Hands the newest target from isr_rx to the main loop without tearing it.
+Double buffered seqlock: the writer fills the slot the reader is not meant to
+be looking at, then bumps seq to publish it. The reader copies slot seq & 1
+and retries if seq moved meanwhile. The writer only comes back round onto
+that slot after publishing the other one, so a copy that could have torn
+always sees seq move.
+
+One writer at a time, isr_rx is the only one. Plain C so it builds on the
+host as well, where the writer may be a thread on another core; the host
+build orders seq against the slots with real fences (host_sim/mailbox_test.c
+runs it). On the PSoC the writer is an ISR on the same core, which finishes
+before the reader resumes, so only the compiler has to be kept in order.
+*******************************************/
+
+#ifndef MAILBOX_ACQUIRE
+#ifdef __linux__
+#define MAILBOX_ACQUIRE() __atomic_thread_fence(__ATOMIC_ACQUIRE)
+#define MAILBOX_RELEASE() __atomic_thread_fence(__ATOMIC_RELEASE)
+#else
+#define MAILBOX_ACQUIRE() __asm volatile("" ::: "memory") // Single core, compiler only
+#define MAILBOX_RELEASE() __asm volatile("" ::: "memory")
+#endif
+#endif
+
+typedef struct
+{
+    int16_t x, y;
+} target;
+
+typedef struct
+{
+    volatile uint32_t seq;
+    volatile target slot[2];
+} mailbox;
+
+static inline void mailbox_write(mailbox *mb, int16_t x, int16_t y)
+{
+    uint32_t seq = mb->seq + 1;
+    MAILBOX_RELEASE(); // The last publish lands before this slot is touched
+    mb->slot[seq & 1].x = x;
+    mb->slot[seq & 1].y = y;
+    MAILBOX_RELEASE();
+    mb->seq = seq;
+}
+
+// Copies the newest target into t and returns its sequence number,
+// which changes exactly when a new target has been written.
+static inline uint32_t mailbox_read(mailbox *mb, target *t)
+{
+    uint32_t seq;
+    do
+    {
+        seq = mb->seq;
+        MAILBOX_ACQUIRE();
+        t->x = mb->slot[seq & 1].x;
+        t->y = mb->slot[seq & 1].y;
+        MAILBOX_ACQUIRE();
+    } while (mb->seq != seq);
+    return seq;
+}
+
+#endif /* MAILBOX_H */
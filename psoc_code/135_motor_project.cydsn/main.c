@@ -1,5 +1,11 @@
 #include "project.h"
 #include "stdlib.h"
+#include "stepper.h"
+#include "events.h"
+#include "mailbox.h"
+#include "params.h"
+#include "profile.h"
+#include "homing.h"
 
 /************* PIN DEFINITONS **************
 Motor 1 Step: Reg 5
@@ -21,63 +27,50 @@ LED: Reg 3
 // X = 8 to X = 139
 // Y = 3 to Y = 175
 
-#define steps_per_pixel 8
+// Speed, acceleration, scale, limits and home offsets are in params.h
 
 /************ FUNCTION PROTOTYPES *******************/
 int printf(const char * format, ...);
-double fabs(double);
-double floor(double);
 /**************************************************/
 
+volatile uint8 events = 0; // EVT_* flags, see events.h
+
 /************ UART RX INTERRUPT *********************/
 volatile int uart_recv_buf[4];
 volatile int uart_recv_count = 0;
-int x_1 = 0; // New point
-int y_1 = 0;
+mailbox target_mb; // New point, from isr_rx
+volatile uint8 param_op;  // Last parameter command, see params.h
+volatile int16 param_value;
 
 CY_ISR(isr_rx)
 {
+    PROFILE_BEGIN(t_0);
     uart_recv_buf[uart_recv_count] = UART_GetChar();
     uart_recv_count += 1;
 
     if (uart_recv_count > 3)
     {
-        x_1 = uart_recv_buf[0]; // new coords
-        y_1 = uart_recv_buf[1];
+        if (uart_recv_buf[0] == CMD_START)
+        {
+            param_op = uart_recv_buf[1];
+            param_value = (int16)(uart_recv_buf[2] | (uart_recv_buf[3] << 8));
+            post_event(EVT_PARAM);
+        }
+        else
+        {
+            mailbox_write(&target_mb, uart_recv_buf[0], uart_recv_buf[1]); // new coords
+            post_event(EVT_TARGET);
+        }
         uart_recv_count = 0;
-        
     }
+    PROFILE_END(PROF_RX, t_0, PROFILE_DELAY_CHAINED);
 }
 /*************************************************/
 
-/************** MOTOR PULSE INTERRUPT ***************/
-float x_0 = 0, y_0 = 0, dx = 0, dy = 0; // always start at (0, 0)
-float m1_steps = 0, m2_steps = 0;
-int m1_dir = 0, m2_dir = 0;
-int m1_dir_pin = 0, m2_dir_pin = 0;
-int m1_step_pin = 0, m2_step_pin = 0;
-
-CY_ISR(pulse_ready_isr)
-{
-    Control_Reg_5_Write(m1_step_pin); // Motor step
-    Control_Reg_6_Write(m2_step_pin);
-    
-    x_0 += -((float)m1_dir + (float)m2_dir) / (2 * steps_per_pixel);
-    y_0 += ((float)m1_dir - (float)m2_dir) / (2 * steps_per_pixel);
-    
-    Control_Reg_5_Write(0); // Motor reset
-    Control_Reg_6_Write(0);
-}    
-   
-/***********************************************/
-
-/****************** (0, 0) ROUTINE ****************/
+/****************** LIMIT SWITCHES ****************/
 CY_ISR(pos_reset)
 {
-    x_1 = 0;
-    y_1 = 0;
-    x_0 = 0;
-    y_0 = 0;
+    post_event(EVT_RESET); // Homing runs from the main loop, see homing.h
     Pin_1_ClearInterrupt();
     //printf("Position reset"); //For debugging
 }
@@ -90,17 +83,16 @@ int main(void)
     UART_Start(); // Obvi must call before next line
     printf("Program started...");
 
-    /****************** PWM INIT **************************/
-    /* Must happen before PULSE CLOCK INIT or might miss pulses */
-    PWM_1_Start();
-    PWM_2_Start();
-    
-    /****************** PULSE CLOCK INIT *********************/
-    /* The period between motor pulses is set according to:
-    PULSE_PERIOD = BUS_CLK_FREQUENCY_HZ * DESIRED_PERIOD_SEC */
-    Timer_1_Start(); // PULSE_PERIOD is set in Timer_1 block
-    pulse_ready_isr_StartEx(pulse_ready_isr);
-    pulse_ready_isr_Enable();
+    /****************** PARAMS INIT *********************/
+    printf(params_load() ? "params loaded\n" : "params defaults\n");
+    /**************************************************/
+
+#if PROFILE == 1
+    profile_start(); // Before the ISRs it times
+#endif
+
+    /****************** STEP GENERATION INIT *********************/
+    stepper_start(); // Rate is set in stepper.c, not in the Timer_1 block
     /*********************************************************/
     
     /****************** UART INTERRUPT INIT *********************/
@@ -108,60 +100,98 @@ int main(void)
     isr_rx_Enable();        /* arm the UART interrupt*/
     /**************************************************/
     
-    /********************** (0, 0) INIT ***********************/
+    /********************** HOMING INIT ***********************/
     pos_reset_StartEx(pos_reset);
     pos_reset_Enable();
     /************************************************/
     
     CyGlobalIntEnable;      // Enable global interrupts
     
-    Control_Reg_3_Write(0); // Start with LED off
+    homing_start(); // Targets are ignored until it prints ready
+    Control_Reg_4_Write(1); // Motor wake
+    Control_Reg_3_Write(1); // LED on while moving
+
+    int32 m1_target = 0, m2_target = 0; // Last target queued, in motor steps
 
     while (1)
     {
-         //printf("\t(%d, %d)\t", x_1, y_1);
-        dx = (float)x_1 - x_0;
-        dy = (float)y_1 - y_0;
-        //printf("\t(%f, %f)\t", dx, dy);
-        if ( (dx != 0 && x_1 <= 131) || (dy != 0 && y_1 <= 100) )
-        {   
-            Control_Reg_4_Write(m1_step_pin || m2_step_pin); // Motor wake/sleep
-            Control_Reg_3_Write(1); // LED on
-            
-            m1_steps = -(dx - dy) * steps_per_pixel; // Negative because 0 is pos rotation
-            m2_steps = -(dx + dy) * steps_per_pixel; // and 1 is neg rotation (use RHR)
-                
-            m1_dir = m1_steps / fabs(m1_steps); // Dir for increment; -1, 0, 1
-            m2_dir = m2_steps / fabs(m2_steps);
-            
-            m1_dir_pin = 1 == m1_dir; // Dir pin; 0, 1
-            m2_dir_pin = 1 == m2_dir;
-            
-            m1_step_pin = 1 == m1_dir || -1 == m1_dir; // Step pin; 0, 1
-            m2_step_pin = 1 == m2_dir || -1 == m2_dir;
-            
-            // Dir pins
-            Control_Reg_1_Write(m1_dir_pin);
-            Control_Reg_2_Write(m2_dir_pin);
-
-            #define FP_TOL 0.07 // Fixes floating point imprecision
-            if (x_0 > (float)x_1 - FP_TOL && x_0 < (float)x_1 + FP_TOL)
-            {
-                x_0 = x_1;
-            }
-            if (y_0 > (float)y_1 - FP_TOL && y_0 < (float)y_1 + FP_TOL)
+        /* Take the pending events, or sleep until an interrupt arrives. WFI
+           still wakes on an interrupt masked by the critical section, so one
+           posted between the check and the WFI is not missed. */
+        uint8 intr = CyEnterCriticalSection();
+        uint8 e = events;
+        events = 0;
+        if (e == 0)
+        {
+            CY_PM_WFI;
+        }
+        CyExitCriticalSection(intr);
+
+        int16 spp = param[PARAM_STEPS_PER_PIXEL];
+
+        if (e & EVT_PARAM)
+        {
+            if ((param_op & 0xF0) == CMD_PROFILE)
+                profile_dump(param_op & 0x0F);
+            else if (param_op == (CMD_HOME | 1))
+                homing_start();
+            else if (param_op == CMD_HOME)
+                homing_status();
+            else
+                params_command(param_op, param_value);
+        }
+
+        if (!homing_done())
+        {
+            homing_update(e);
+            if (homing_done())
+                stepper_position(&m1_target, &m2_target);
+        }
+        else if (e & EVT_RESET)
+        {
+            // A switch only closes past the soft limits if steps were lost
+            printf("limit hit\n");
+            homing_start();
+        }
+        else if (e & EVT_TARGET)
+        {
+            target t;
+            mailbox_read(&target_mb, &t);
+            //printf("\t(%d, %d)\t", t.x, t.y);
+
+            /* The switches close at home, so anything nearer than the homing
+               backoff is pulled in to it rather than driven onto a switch and
+               taken for lost steps. The idle target (PUCK_HOME, 0) lands here. */
+            int16 x_min = param[PARAM_HOME_X] + (HOME_BACKOFF + spp - 1) / spp;
+            int16 y_min = param[PARAM_HOME_Y] + (HOME_BACKOFF + spp - 1) / spp;
+            if (x_min < param[PARAM_X_MIN])
+                x_min = param[PARAM_X_MIN];
+            if (y_min < param[PARAM_Y_MIN])
+                y_min = param[PARAM_Y_MIN];
+            if (t.x < x_min)
+                t.x = x_min;
+            if (t.y < y_min)
+                t.y = y_min;
+
+            if (t.x <= param[PARAM_X_MAX] && t.y <= param[PARAM_Y_MAX]) // Upper soft limits
             {
-                y_0 = y_1;
+                int32 m1 = -(t.x - t.y) * spp; // Negative because 0 is pos rotation
+                int32 m2 = -(t.x + t.y) * spp; // and 1 is neg rotation (use RHR)
+
+                // Replan from the current speed toward the newest target
+                if ((m1 != m1_target || m2 != m2_target) && stepper_retarget(m1, m2, param[PARAM_MAX_SPEED]))
+                {
+                    m1_target = m1;
+                    m2_target = m2;
+                }
             }
         }
-        else
+
+        if (e != 0)
         {
-            m1_dir = 0; m2_dir = 0;
-            m1_step_pin = 0, m2_step_pin = 0;
-            Control_Reg_4_Write(0); // Motor sleep
-            Control_Reg_3_Write(0); // LED off if no movement
+            uint8 moving = stepper_busy();
+            Control_Reg_4_Write(moving); // Motor wake/sleep
+            Control_Reg_3_Write(moving); // LED on while moving
         }
     }
 }
-
-
@@ -0,0 +1,151 @@
+#include "params.h"
+#include "planner.h"
+#include "stepper.h"
+#include "cy_em_eeprom.h"
+
+#include <string.h>
+
+int printf(const char *format, ...);
+
+#define PARAMS_MAGIC 0x5032 // Bump when the layout changes
+#define PARAMS_EEPROM_SIZE (CY_EM_EEPROM_FLASH_SIZEOF_ROW / 2)
+
+typedef struct
+{
+    const char *name;
+    int16 def, min, max;
+} param_info;
+
+static const param_info info[NUM_PARAMS] = {
+    {"steps_per_pixel", 8, 1, 64},
+    {"max_speed", 2400, 100, 20000},
+    {"accel", 15000, 500, 30000},
+    {"x_max", 131, 0, 139},
+    {"y_max", 100, 0, 200},
+    {"home_x", 0, -50, 50},
+    {"home_y", 0, -50, 50},
+    {"x_min", 4, -50, 139},
+    {"y_min", 4, -50, 200},
+};
+
+volatile int16 param[NUM_PARAMS];
+
+/* What is kept in EEPROM */
+typedef struct
+{
+    uint16 magic;
+    int16 value[NUM_PARAMS];
+} params_image;
+
+CY_ALIGN(CY_EM_EEPROM_FLASH_SIZEOF_ROW)
+static const uint8 eeprom_storage[CY_EM_EEPROM_GET_PHYSICAL_SIZE(PARAMS_EEPROM_SIZE, 1u, 0u)] = {0u};
+
+static cy_stc_eeprom_context_t eeprom_context;
+static uint8 eeprom_ok = 0;
+
+// Pushes params that are cached elsewhere
+static void apply(void)
+{
+    planner_set_accel(param[PARAM_ACCEL]);
+}
+
+static void defaults(void)
+{
+    uint8 i;
+    for (i = 0; i < NUM_PARAMS; i++)
+        param[i] = info[i].def;
+}
+
+uint8 params_load(void)
+{
+    cy_stc_eeprom_config_t config;
+    params_image image;
+    uint8 i, loaded = 0;
+
+    defaults();
+
+    config.eepromSize = PARAMS_EEPROM_SIZE;
+    config.wearLevelingFactor = 1u;
+    config.redundantCopy = 0u;
+    config.blockingWrite = 1u;
+    config.userFlashStartAddr = (uint32)(uintptr_t)eeprom_storage;
+    eeprom_ok = Cy_Em_EEPROM_Init(&config, &eeprom_context) == CY_EM_EEPROM_SUCCESS;
+
+    // A few dozen bytes straight out of flash, well under a millisecond
+    if (eeprom_ok && Cy_Em_EEPROM_Read(0u, &image, sizeof(image), &eeprom_context) == CY_EM_EEPROM_SUCCESS &&
+        image.magic == PARAMS_MAGIC)
+    {
+        loaded = 1;
+        for (i = 0; i < NUM_PARAMS; i++)
+        {
+            if (image.value[i] >= info[i].min && image.value[i] <= info[i].max)
+                param[i] = image.value[i];
+        }
+    }
+
+    apply();
+    return loaded;
+}
+
+static void print_param(uint8 id)
+{
+    printf("%s %d\n", info[id].name, param[id]);
+}
+
+void params_command(uint8 op_id, int16 value)
+{
+    uint8 op = op_id & 0xF0, id = op_id & 0x0F;
+    uint8 i;
+
+    if ((op == CMD_GET || op == CMD_SET) && id >= NUM_PARAMS)
+    {
+        printf("bad param %d\n", id);
+        return;
+    }
+
+    switch (op)
+    {
+    case CMD_GET:
+        print_param(id);
+        break;
+    case CMD_SET:
+        if (value < info[id].min || value > info[id].max)
+        {
+            printf("%s out of range %d..%d\n", info[id].name, info[id].min, info[id].max);
+            break;
+        }
+        param[id] = value;
+        apply();
+        print_param(id);
+        break;
+    case CMD_SAVE:
+        if (!eeprom_ok || stepper_busy()) // Flash row write stalls the CPU, don't do it mid-move
+        {
+            printf("save failed\n");
+            break;
+        }
+        {
+            params_image image;
+            memset(&image, 0, sizeof(image));
+            image.magic = PARAMS_MAGIC;
+            for (i = 0; i < NUM_PARAMS; i++)
+                image.value[i] = param[i];
+            printf(Cy_Em_EEPROM_Write(0u, &image, sizeof(image), &eeprom_context) == CY_EM_EEPROM_SUCCESS
+                       ? "saved\n"
+                       : "save failed\n");
+        }
+        break;
+    case CMD_DEFAULTS:
+        defaults();
+        apply();
+        printf("defaults\n");
+        break;
+    case CMD_LIST:
+        for (i = 0; i < NUM_PARAMS; i++)
+            print_param(i);
+        break;
+    default:
+        printf("bad command %d\n", op);
+        break;
+    }
+}
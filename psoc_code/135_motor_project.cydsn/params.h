@@ -0,0 +1,45 @@
+#ifndef PARAMS_H
+#define PARAMS_H
+
+#include "project.h"
+
+/************* MOTION PARAMETERS **************
+Tunable over the serial link and kept in emulated EEPROM, so changing them
+does not need a reflash. Loaded at boot, falling back to the defaults in
+params.c if the EEPROM is blank or from an older layout.
+
+Commands share the 4-byte packet with targets and are told apart by a
+first byte of 0xFF, which no gantry x can be:
+    [0xFF, op | id, value lo, value hi]
+Replies are printf text, so send commands with main.cpp stopped.
+*******************************************/
+
+#define PARAM_STEPS_PER_PIXEL 0
+#define PARAM_MAX_SPEED 1 // Along the path [steps/s]
+#define PARAM_ACCEL 2     // Along the path [steps/s^2]
+#define PARAM_X_MAX 3     // Soft travel limits [px]
+#define PARAM_Y_MAX 4
+#define PARAM_HOME_X 5    // Gantry x when the x limit switch closes, y likewise [px]
+#define PARAM_HOME_Y 6
+#define PARAM_X_MIN 7     // Lower soft limits [px], never less than HOME_BACKOFF past home
+#define PARAM_Y_MIN 8
+#define NUM_PARAMS 9
+
+#define CMD_START 0xFF
+#define CMD_GET 0x10      // Print param id
+#define CMD_SET 0x20      // Set param id to value, not saved
+#define CMD_SAVE 0x30     // Write every param to EEPROM
+#define CMD_DEFAULTS 0x40 // Restore the defaults, not saved
+#define CMD_LIST 0x50     // Print every param
+#define CMD_PROFILE 0x60  // Print the ISR histograms, id 1 also clears them, see profile.h
+#define CMD_HOME 0x70     // Print ready, homing or home failed, id 1 homes again, see homing.h
+
+extern volatile int16 param[NUM_PARAMS];
+
+// Starts the emulated EEPROM and loads the saved params, returns 0 if the defaults were used
+uint8 params_load(void);
+
+// Runs one [op | id, value] command and prints the result
+void params_command(uint8 op_id, int16 value);
+
+#endif /* PARAMS_H */
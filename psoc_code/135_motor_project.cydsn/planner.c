@@ -0,0 +1,249 @@
+#include "planner.h"
+
+#include <math.h>
+
+#define NEXT(i) (((i) + 1) & (PLANNER_SIZE - 1))
+#define PREV(i) (((i) - 1) & (PLANNER_SIZE - 1))
+
+typedef struct
+{
+    segment ring[PLANNER_SIZE];
+    volatile uint8_t head, tail; // Next free, oldest (being stepped)
+    int32_t end_m1, end_m2;      // Position at the end of the queue
+} queue;
+
+static queue queues[2];
+static queue *volatile active = &queues[0]; // Stepped by the ISR
+static queue *plan = &queues[1];            // Planned into by the main loop
+static uint8_t plan_tail;                   // Active tail when the plan was copied
+static float accel = PLANNER_ACCEL;         // Along the path [steps/s^2]
+
+void planner_set_accel(float a)
+{
+    accel = a;
+}
+
+void planner_begin(void)
+{
+    *plan = *active;
+    plan_tail = plan->tail;
+}
+
+uint8_t planner_commit(void)
+{
+    if (active->tail != plan_tail)
+        return 0; // A segment finished meanwhile, the plan started from the one before
+    queue *q = active;
+    active = plan;
+    plan = q;
+    return 1;
+}
+
+void planner_clear(int32_t m1, int32_t m2)
+{
+    plan->head = plan->tail = 0;
+    plan->end_m1 = m1;
+    plan->end_m2 = m2;
+}
+
+uint8_t planner_count(void)
+{
+    queue *q = active;
+    return (q->head - q->tail) & (PLANNER_SIZE - 1);
+}
+
+segment *planner_current(void)
+{
+    queue *q = active;
+    return q->head == q->tail ? 0 : &q->ring[q->tail];
+}
+
+void planner_discard(void)
+{
+    queue *q = active;
+    if (q->head != q->tail)
+        q->tail = NEXT(q->tail);
+}
+
+// Fastest speed from which the segment can still brake (or accelerate) to v over its length
+static float reachable(float v, const segment *s)
+{
+    return sqrtf(v * v + 2 * accel * s->length);
+}
+
+/* Converts a segment's entry, cruise and exit speeds from path steps to
+   major axis ticks for the step ISR. */
+static void ramp(segment *s, float exit_v)
+{
+    float k = s->ticks / s->length; // Ticks per path step
+    float a = accel * k;            // [ticks/s^2]
+    float entry = s->entry_v * k, nominal = s->nominal_v * k, exit = exit_v * k;
+
+    if (entry < PLANNER_MIN_RATE)
+        entry = PLANNER_MIN_RATE;
+    if (exit < PLANNER_MIN_RATE)
+        exit = PLANNER_MIN_RATE;
+    if (nominal < entry)
+        nominal = entry;
+
+    /* v = F / c and n = v^2 / 2a, so n = F^2 / (2a c^2). Every n comes from
+       its c the same way so the ISR's ramp and the plan agree. */
+    float f = PLANNER_TIMER_HZ * (1 << PLANNER_C_SHIFT);
+    s->n_num = (uint64_t)(f * f / (2 * a));
+    s->entry_c = (uint32_t)(f / entry);
+    s->entry_n = (uint32_t)(s->n_num / ((uint64_t)s->entry_c * s->entry_c));
+    s->nominal_c = (uint32_t)(f / nominal);
+    s->nominal_n = (uint32_t)(s->n_num / ((uint64_t)s->nominal_c * s->nominal_c));
+    uint32_t exit_c = (uint32_t)(f / exit);
+    s->exit_n = (uint32_t)(s->n_num / ((uint64_t)exit_c * exit_c));
+    s->k_q = (uint32_t)(k * 65536);
+}
+
+/* Reverse pass from the newest segment, which must end at rest, then a
+   forward pass from the one being stepped, whose entry is already fixed. */
+static void recalculate(queue *q)
+{
+    segment *ring = q->ring;
+    uint8_t i, tail = q->tail, newest = PREV(q->head);
+
+    float next_entry = 0;
+    for (i = newest; i != tail; i = PREV(i))
+    {
+        segment *s = &ring[i];
+        float v = reachable(next_entry, s);
+        s->entry_v = v < s->max_entry_v ? v : s->max_entry_v;
+        next_entry = s->entry_v;
+    }
+
+    for (i = tail; i != newest; i = NEXT(i))
+    {
+        segment *s = &ring[i], *n = &ring[NEXT(i)];
+        float v = reachable(s->entry_v, s);
+        if (n->entry_v > v)
+            n->entry_v = v;
+        ramp(s, n->entry_v);
+    }
+    ramp(&ring[newest], 0);
+}
+
+uint8_t planner_add(int32_t m1, int32_t m2, float v)
+{
+    queue *q = plan;
+    int32_t d1 = m1 - q->end_m1, d2 = m2 - q->end_m2;
+    if (d1 == 0 && d2 == 0)
+        return 1;
+    if (NEXT(q->head) == q->tail)
+        return 0;
+
+    segment *s = &q->ring[q->head];
+    s->start_m1 = q->end_m1;
+    s->start_m2 = q->end_m2;
+    s->m1 = d1;
+    s->m2 = d2;
+    uint32_t a1 = d1 > 0 ? d1 : -d1, a2 = d2 > 0 ? d2 : -d2;
+    s->major = s->ticks = a1 > a2 ? a1 : a2;
+    s->length = sqrtf((float)d1 * d1 + (float)d2 * d2);
+
+    // Keep the major axis under the fastest tick rate
+    float v_max = PLANNER_MAX_RATE * s->length / s->major;
+    s->nominal_v = v < v_max ? v : v_max;
+
+    s->max_entry_v = 0; // From rest if nothing is queued ahead of it
+    s->entry_v = 0;
+    if (q->head != q->tail)
+    {
+        /* Junction deviation: the fastest speed at which a circular arc
+           PLANNER_JUNCTION_DEV from the corner stays within accel */
+        segment *p = &q->ring[PREV(q->head)];
+        float p_length = sqrtf((float)p->m1 * p->m1 + (float)p->m2 * p->m2); // Uncut
+        float cos_theta = -((float)p->m1 * d1 + (float)p->m2 * d2) / (p_length * s->length);
+        float vj = s->nominal_v < p->nominal_v ? s->nominal_v : p->nominal_v;
+        if (cos_theta > 0.999f)
+        {
+            vj = 0; // Reversal
+        }
+        else if (cos_theta > -0.999f)
+        {
+            float sin_half = sqrtf(0.5f * (1 - cos_theta));
+            float v_corner = sqrtf(accel * PLANNER_JUNCTION_DEV * sin_half / (1 - sin_half));
+            if (v_corner < vj)
+                vj = v_corner;
+        }
+        s->max_entry_v = vj;
+    }
+
+    q->head = NEXT(q->head);
+    q->end_m1 = m1;
+    q->end_m2 = m2;
+    recalculate(q);
+    return 1;
+}
+
+// Steps taken by one motor after t ticks, same rounding as the step ISR's DDA
+static int32_t dda_steps(int32_t m, uint32_t major, uint32_t t)
+{
+    uint32_t n = m > 0 ? m : -m;
+    int32_t steps = (major / 2 + t * n) / major;
+    return m > 0 ? steps : -steps;
+}
+
+// Cuts a segment to its first run ticks
+static void cut(segment *s, uint32_t run)
+{
+    if (run < 1)
+        run = 1;
+    if (run < s->ticks)
+    {
+        s->length *= (float)run / s->ticks;
+        s->ticks = run;
+    }
+}
+
+uint8_t planner_retarget(uint32_t tick, uint32_t n, int32_t m1, int32_t m2, float v)
+{
+    queue *q = plan;
+    if (m1 == q->end_m1 && m2 == q->end_m2)
+        return 1;
+    if (q->head == q->tail)
+        return planner_add(m1, m2, v);
+
+    /* Keep the queued path up to the braking distance, n ticks of the segment
+       being stepped at its current speed, and drop everything after it. The
+       queue always ends at rest, so the cut always lands inside it. */
+    uint8_t i = q->tail;
+    segment *s = &q->ring[i];
+    uint32_t left = s->ticks - tick;
+    if (n <= left)
+    {
+        cut(s, tick + n);
+    }
+    else
+    {
+        float d = (n - left) * s->length / s->ticks; // Past the end of it [path steps]
+        for (i = NEXT(i); i != q->head; i = NEXT(i))
+        {
+            s = &q->ring[i];
+            if (d <= s->length)
+            {
+                cut(s, (uint32_t)(d * s->ticks / s->length + 0.5f));
+                break;
+            }
+            d -= s->length;
+        }
+        if (i == q->head)
+        {
+            i = PREV(q->head);
+            s = &q->ring[i];
+        }
+    }
+    q->head = NEXT(i);
+    q->end_m1 = s->start_m1 + dda_steps(s->m1, s->major, s->ticks);
+    q->end_m2 = s->start_m2 + dda_steps(s->m2, s->major, s->ticks);
+
+    if (m1 == q->end_m1 && m2 == q->end_m2)
+    {
+        recalculate(q); // Target is where the cut leaves it, just brake
+        return 1;
+    }
+    return planner_add(m1, m2, v);
+}
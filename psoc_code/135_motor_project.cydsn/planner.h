@@ -0,0 +1,93 @@
+#ifndef PLANNER_H
+#define PLANNER_H
+
+#include <stdint.h>
+
+#include "cyfitter.h"
+
+/************* MOTION PLANNER **************
+Ring buffer of straight gantry moves in motor step space. Each new target is
+queued as a segment; the junction speed with the previous segment comes from
+the angle between them, and a reverse then forward pass over the queue keeps
+every segment's entry speed reachable, so the gantry only stops at the end of
+the queue or at a sharp reversal. Each segment carries its entry, cruise and
+exit speeds in major axis ticks for the step ISR to ramp between.
+
+A new target can also replace the queue outright (planner_retarget). The
+queued path is cut at the current braking distance, so the gantry keeps its
+speed into the new move if the direction allows and can always stop if it
+does not.
+
+The queue the step ISR steps is never planned in place. planner_begin
+copies it, planner_clear / add / retarget work on the copy with the ISR
+running, and planner_commit swaps the copy in. The ISR only reads segments
+and moves tail, so the copy can be taken with it running, and the commit is
+refused if tail moved while planning.
+
+Plain C with no PSoC headers but cyfitter.h for the clock, which the host
+simulator stands in for, so it builds on the host as well.
+*******************************************/
+
+#define PLANNER_SIZE 8 // Power of two
+
+#define PLANNER_TIMER_HZ ((float)BCLK__BUS_CLK__HZ) // Timer_1 clock, BUS_CLK
+#define PLANNER_ACCEL 15000.0f                      // Default along the path [steps/s^2]
+#define PLANNER_JUNCTION_DEV 8.0f                   // Allowed corner rounding [steps], one pixel
+#define PLANNER_MIN_RATE ((float)((BCLK__BUS_CLK__HZ + 65534) / 65535)) // Slowest tick rate, Timer_1 is 16 bit [ticks/s]
+#define PLANNER_MAX_RATE 20000.0f                   // Fastest tick rate [ticks/s]
+#define PLANNER_C_SHIFT 4                           // Fraction bits of the tick period
+
+typedef struct
+{
+    int32_t start_m1, start_m2; // Absolute position at the start
+    int32_t m1, m2;             // Motor steps, signed
+    uint32_t major;             // max(|m1|, |m2|), DDA denominator
+    uint32_t ticks;             // Ticks to run, less than major if cut short
+    float length;               // Euclidean length of the ticks run [steps]
+
+    float nominal_v;   // Cruise speed along the path [steps/s]
+    float max_entry_v; // Junction limit with the previous segment
+    float entry_v;     // Planned entry speed
+
+    /* Speeds for the step ISR in major axis ticks. Periods are in Timer_1
+       clocks << PLANNER_C_SHIFT, n is the AVR446 ramp index, which is also
+       the number of ticks it takes to brake to rest from that speed. The ISR
+       brakes once the ticks left are down to n - exit_n. */
+    uint32_t entry_c, entry_n;
+    uint32_t nominal_c, nominal_n;
+    uint32_t exit_n;
+    uint32_t k_q;   // Ticks per path step, Q16, to carry speed into the next segment
+    uint64_t n_num; // n = n_num / c^2, to resync the ramp index with c
+} segment;
+
+// Acceleration for segments planned from now on [steps/s^2]
+void planner_set_accel(float a);
+
+// Copies the queue being stepped for planning into
+void planner_begin(void);
+
+// Makes the planned copy the queue being stepped, call with the step ISR
+// masked. Returns 0 and keeps the old queue if a segment was discarded
+// since planner_begin, as the plan then starts from a finished one.
+uint8_t planner_commit(void);
+
+// Empties the planned queue and sets where the next segment starts from
+void planner_clear(int32_t m1, int32_t m2);
+
+// Queues a move to absolute motor position (m1, m2) at up to v [steps/s].
+// Returns 0 if the queue is full, 1 otherwise (including a zero length move).
+uint8_t planner_add(int32_t m1, int32_t m2, float v);
+
+// Replaces the queue with a move to (m1, m2). The path already queued is kept
+// up to the braking distance, n ticks on from tick in the segment being stepped.
+uint8_t planner_retarget(uint32_t tick, uint32_t n, int32_t m1, int32_t m2, float v);
+
+// Oldest segment of the queue being stepped, or 0 if it is empty
+segment *planner_current(void);
+
+// Drops the oldest segment once it has been stepped
+void planner_discard(void);
+
+uint8_t planner_count(void);
+
+#endif /* PLANNER_H */
@@ -0,0 +1,108 @@
+#include "profile.h"
+
+#include <string.h>
+
+int printf(const char *format, ...);
+
+#if PROFILE == 1
+
+#ifdef PROFILE_DWT
+#include "core_cm3_psoc5.h"
+#endif
+
+typedef struct
+{
+    uint32 count[PROFILE_BUCKETS];
+    uint32 max;
+} histogram;
+
+static histogram run[NUM_PROF_ISRS], delay[NUM_PROF_ISRS];
+static uint32 last_start[NUM_PROF_ISRS], last_end[NUM_PROF_ISRS];
+
+static const char *const names[NUM_PROF_ISRS] = {"step", "rx"};
+
+void profile_start(void)
+{
+    memset(run, 0, sizeof(run));
+    memset(delay, 0, sizeof(delay));
+#ifdef PROFILE_DWT
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+#endif
+}
+
+static void add(histogram *h, uint32 cycles)
+{
+    uint8 b = cycles == 0 ? 0 : 32 - __builtin_clz(cycles);
+    if (b >= PROFILE_BUCKETS)
+        b = PROFILE_BUCKETS - 1;
+    h->count[b]++;
+    if (cycles > h->max)
+        h->max = cycles;
+}
+
+void profile_isr(uint8 isr, uint32 t_0, uint32 d)
+{
+    uint32 t_1 = PROFILE_CYCLES();
+    uint8 i;
+
+    if (d == PROFILE_DELAY_CHAINED)
+    {
+        d = 0;
+        for (i = 0; i < NUM_PROF_ISRS; i++)
+        {
+            // Wrapping subtraction, the counter rolls over every three minutes
+            if (i != isr && t_0 - last_end[i] <= PROFILE_TAIL_CHAIN && last_end[i] - last_start[i] > d)
+                d = last_end[i] - last_start[i];
+        }
+    }
+
+    add(&run[isr], t_1 - t_0);
+    add(&delay[isr], d);
+    last_start[isr] = t_0;
+    last_end[isr] = t_1;
+}
+
+static void print(const char *name, const char *what, histogram *h)
+{
+    uint8 b;
+    printf("%s %s max %lu:", name, what, (unsigned long)h->max);
+    for (b = 0; b < PROFILE_BUCKETS; b++)
+        printf(" %lu", (unsigned long)h->count[b]);
+    printf("\n");
+}
+
+void profile_dump(uint8 clear)
+{
+    uint8 i, intr;
+    histogram r, d;
+
+    printf("buckets <1 <2 <4 .. <2^%d, >=2^%d cycles\n", PROFILE_BUCKETS - 2, PROFILE_BUCKETS - 2);
+    for (i = 0; i < NUM_PROF_ISRS; i++)
+    {
+        // Copy out in one go so a histogram is not printed half updated
+        intr = CyEnterCriticalSection();
+        r = run[i];
+        d = delay[i];
+        if (clear)
+        {
+            memset(&run[i], 0, sizeof(histogram));
+            memset(&delay[i], 0, sizeof(histogram));
+        }
+        CyExitCriticalSection(intr);
+
+        print(names[i], "run", &r);
+        print(names[i], "delay", &d);
+    }
+}
+
+#else
+
+void profile_dump(uint8 clear)
+{
+    (void)clear;
+    printf("profiling off, set PROFILE in profile.h\n");
+}
+
+#endif
@@ -0,0 +1,52 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include "project.h"
+
+/************* ISR PROFILING **************
+Histograms of how long each ISR runs and how late it starts, in CPU cycles
+(BUS_CLK) from the DWT cycle counter. Buckets are powers of two, bucket k
+counts [2^(k-1), 2^k) cycles, and the last one everything above.
+
+pulse_ready_isr's delay is exact, read off Timer_1 as cycles since terminal
+count. isr_rx has no timestamp for its byte, but it shares a priority with
+pulse_ready_isr so neither preempts the other: if it tail chains straight
+after pulse_ready_isr, its delay is counted as that ISR's whole run, an upper
+bound, and as 0 otherwise.
+
+Dump with the [0xFF, CMD_PROFILE | clear, 0, 0] command, see params.h.
+*******************************************/
+
+#define PROFILE 0 // 1 to build the profiling in, costs ~40 cycles per ISR
+
+#define PROFILE_BUCKETS 16
+#define PROFILE_TAIL_CHAIN 48 // Most cycles from one ISR's exit to the next one's entry when tail chained
+
+#define PROF_STEP 0 // pulse_ready_isr
+#define PROF_RX 1   // isr_rx
+#define NUM_PROF_ISRS 2
+
+#ifndef PROFILE_CYCLES
+#define PROFILE_CYCLES() (DWT->CYCCNT)
+#define PROFILE_DWT
+#endif
+
+#if PROFILE == 1
+#define PROFILE_DELAY_CHAINED 0xFFFFFFFFu // Estimate the delay from tail chaining
+
+void profile_start(void);
+
+// Records one run of isr, which started at cycle t_0. Call last thing in the ISR.
+void profile_isr(uint8 isr, uint32 t_0, uint32 delay);
+
+#define PROFILE_BEGIN(t_0) uint32 t_0 = PROFILE_CYCLES()
+#define PROFILE_END(isr, t_0, delay) profile_isr(isr, t_0, delay)
+#else
+#define PROFILE_BEGIN(t_0)
+#define PROFILE_END(isr, t_0, delay)
+#endif
+
+// Prints every histogram, then empties them if clear is set
+void profile_dump(uint8 clear);
+
+#endif /* PROFILE_H */
@@ -0,0 +1,229 @@
+#include "stepper.h"
+#include "planner.h"
+#include "events.h"
+#include "profile.h"
+
+#define C_MAX (65536u << PLANNER_C_SHIFT) // Longest Timer_1 period
+#define C_IDLE ((BCLK__BUS_CLK__HZ / STEP_IDLE_RATE) << PLANNER_C_SHIFT)
+
+#define PLAN_MARGIN 16 // Ticks the gantry may step while a retarget is planned
+#define PLAN_TRIES 3   // Plans dropped before planning with this ISR masked
+
+/* Step ISR state. The segment itself lives in the planner ring, which the
+   main loop plans a copy of and swaps in with this ISR masked. */
+static segment *seg = 0;                       // Segment being stepped
+static uint32 tick = 0;                        // Ticks done in seg
+static uint32 c = C_IDLE, n = 0;               // Tick period and AVR446 ramp index
+static uint32 m1_n = 0, m2_n = 0;              // |steps| in seg
+static uint32 m1_acc = 0, m2_acc = 0;          // DDA accumulators
+static volatile int32 m1_pos = 0, m2_pos = 0;  // Absolute position [steps]
+static int8 m1_inc = 0, m2_inc = 0;            // +1 / -1 per step
+
+// Starts the next queued segment. prev_k_q is the tick scale of the segment
+// just finished, or 0 if the gantry is starting from rest.
+static void load_segment(uint32 prev_k_q)
+{
+    seg = planner_current();
+    if (seg == 0)
+    {
+        c = C_IDLE;
+        return;
+    }
+
+    Control_Reg_1_Write(seg->m1 > 0); // Dir pins
+    Control_Reg_2_Write(seg->m2 > 0);
+    m1_inc = seg->m1 > 0 ? 1 : -1;
+    m2_inc = seg->m2 > 0 ? 1 : -1;
+    m1_n = seg->m1 > 0 ? seg->m1 : -seg->m1;
+    m2_n = seg->m2 > 0 ? seg->m2 : -seg->m2;
+    m1_acc = m2_acc = seg->major / 2; // Centre the minor axis steps in the segment
+    tick = 0;
+
+    if (prev_k_q != 0)
+    {
+        // Carry the path speed over, rescaled to this segment's ticks
+        c = (uint32)((uint64)c * prev_k_q / seg->k_q);
+        if (c > C_MAX)
+            c = C_MAX;
+    }
+    else
+    {
+        c = seg->entry_c;
+    }
+    // The recurrence drifts at low n, so start each segment from n = v^2 / 2a
+    n = (uint32)(seg->n_num / ((uint64)c * c));
+}
+
+/************** MOTOR PULSE INTERRUPT ***************/
+CY_ISR(pulse_ready_isr)
+{
+    PROFILE_BEGIN(t_0);
+#if PROFILE == 1
+    // Timer_1 counts down from its period, so what it has counted is how late we are
+    uint16 late = Timer_1_ReadPeriod() - Timer_1_ReadCounter();
+#endif
+
+    if (seg == 0)
+    {
+        load_segment(0);
+        if (seg == 0)
+        {
+            PROFILE_END(PROF_STEP, t_0, late);
+            return;
+        }
+    }
+
+    m1_acc += m1_n;
+    m2_acc += m2_n;
+    uint8 m1 = m1_acc >= seg->major;
+    uint8 m2 = m2_acc >= seg->major;
+
+    Control_Reg_5_Write(m1); // Trigger one-shot step pulse
+    Control_Reg_6_Write(m2);
+
+    m1_acc -= m1 * seg->major;
+    m2_acc -= m2 * seg->major;
+    m1_pos += m1 * m1_inc;
+    m2_pos += m2 * m2_inc;
+    tick++;
+
+    // Period until the next tick: brake once the ticks left are down to the
+    // braking distance to the exit speed, otherwise ramp toward cruise
+    uint32 left = seg->ticks - tick;
+    if (left == 0)
+    {
+        uint32 k_q = seg->k_q;
+        planner_discard();
+        load_segment(k_q);
+        if (seg == 0)
+            post_event(EVT_IDLE);
+    }
+    else if ((n > seg->exit_n && left <= n - seg->exit_n) || n > seg->nominal_n)
+    {
+        if (n > 1 && c < C_MAX) // Hold n at the slowest rate so it stays in step with c
+        {
+            c += 2 * c / (4 * n - 1);
+            n--;
+        }
+    }
+    else if (n < seg->nominal_n)
+    {
+        n++;
+        c -= 2 * c / (4 * n + 1);
+        if (c < seg->nominal_c)
+        {
+            c = seg->nominal_c;
+            n = seg->nominal_n;
+        }
+    }
+    if (c > C_MAX)
+        c = C_MAX;
+    Timer_1_WritePeriod((uint16)((c >> PLANNER_C_SHIFT) - 1));
+
+    Control_Reg_5_Write(0); // Re-arm trigger
+    Control_Reg_6_Write(0);
+    PROFILE_END(PROF_STEP, t_0, late);
+}
+/***********************************************/
+
+void stepper_start(void)
+{
+    planner_begin();
+    planner_clear(0, 0);
+    planner_commit();
+
+    /* PWM must start before the pulse clock or the first steps are lost */
+    PWM_1_Start();
+    PWM_2_Start();
+
+    Timer_1_Start();
+    Timer_1_WritePeriod((uint16)((C_IDLE >> PLANNER_C_SHIFT) - 1));
+    pulse_ready_isr_StartEx(pulse_ready_isr);
+    pulse_ready_isr_Enable();
+}
+
+/* Plans with the ISR running, which is a few sqrtf and divides per queued
+   segment in soft float, and only masks it to snapshot where it is and to
+   swap the plan in. A retarget cuts PLAN_MARGIN ticks past the braking
+   distance to cover the ticks stepped meanwhile. The plan is dropped and
+   made again if the ISR finished a segment, or stepped more than the margin,
+   before it could be swapped in; the last try plans with the ISR masked. */
+static uint8 plan(int32 m1, int32 m2, float v, uint8 retarget)
+{
+    uint8 i, queued = 0;
+    for (i = 0; i <= PLAN_TRIES; i++)
+    {
+        uint8 masked = i == PLAN_TRIES;
+
+        if (masked)
+            pulse_ready_isr_Disable();
+        planner_begin();
+        pulse_ready_isr_Disable();
+        segment *seg_0 = seg;
+        uint32 tick_0 = tick, n_0 = n;
+        if (!masked)
+            pulse_ready_isr_Enable();
+
+        if (!retarget)
+        {
+            queued = planner_add(m1, m2, v);
+        }
+        else if (seg_0 != 0)
+        {
+            queued = planner_retarget(tick_0, n_0 + PLAN_MARGIN, m1, m2, v);
+        }
+        else
+        {
+            // Stopped, nothing has been stepped from the queue yet
+            planner_clear(m1_pos, m2_pos);
+            queued = planner_add(m1, m2, v);
+        }
+
+        pulse_ready_isr_Disable();
+        if ((seg == 0) == (seg_0 == 0) && (!retarget || tick - tick_0 <= PLAN_MARGIN) && planner_commit())
+        {
+            if (seg != 0)
+                seg = planner_current(); // Same segment in the queue swapped in
+            pulse_ready_isr_Enable();
+            return queued;
+        }
+        pulse_ready_isr_Enable();
+    }
+    return 0; // Not reached, the masked try always commits
+}
+
+uint8 stepper_queue(int32 m1, int32 m2, float v)
+{
+    return plan(m1, m2, v, 0);
+}
+
+uint8 stepper_retarget(int32 m1, int32 m2, float v)
+{
+    return plan(m1, m2, v, 1);
+}
+
+uint8 stepper_busy(void)
+{
+    return planner_count() != 0;
+}
+
+void stepper_position(int32 *m1, int32 *m2)
+{
+    pulse_ready_isr_Disable();
+    *m1 = m1_pos;
+    *m2 = m2_pos;
+    pulse_ready_isr_Enable();
+}
+
+void stepper_set_position(int32 m1, int32 m2)
+{
+    pulse_ready_isr_Disable();
+    seg = 0;
+    c = C_IDLE;
+    planner_begin();
+    planner_clear(m1, m2);
+    planner_commit();
+    m1_pos = m1;
+    m2_pos = m2;
+    pulse_ready_isr_Enable();
+}
@@ -0,0 +1,38 @@
+#ifndef STEPPER_H
+#define STEPPER_H
+
+#include "project.h"
+
+/************* STEP GENERATION **************
+Timer_1 sets the step rate, pulse_ready_isr fires once per Timer_1 period.
+Segments come from the planner queue. Each tick steps the motor with the
+longer move and, when its DDA accumulator overflows, the other one, so the
+shorter move runs at its own proportionally lower rate and both arrive
+together. After each tick the ISR rewrites the Timer_1 period with the
+AVR446 integer ramp, braking once the ticks left in the segment are down
+to its braking distance, so there is no square root per step. Steps trigger PWM_1 / PWM_2 (one-shot, via
+Control_Reg_5 / 6), so the step pulse width is set by the PWM blocks.
+*******************************************/
+
+#define STEP_IDLE_RATE 2000u // Queue polling rate while stopped [ticks/s]
+
+void stepper_start(void);
+
+// Queues a move to absolute motor position (m1, m2) at up to v [steps/s] along the path.
+// Returns 0 if the planner queue is full.
+uint8 stepper_queue(int32 m1, int32 m2, float v);
+
+// Replaces whatever is queued with a move to (m1, m2), carrying the current
+// speed into it as far as the acceleration limit allows
+uint8 stepper_retarget(int32 m1, int32 m2, float v);
+
+// 1 while a segment is being stepped or queued
+uint8 stepper_busy(void);
+
+// Absolute motor position in steps
+void stepper_position(int32 *m1, int32 *m2);
+
+// Stops, drops the queue and makes the current position (m1, m2)
+void stepper_set_position(int32 m1, int32 m2);
+
+#endif /* STEPPER_H */
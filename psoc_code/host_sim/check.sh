@@ -0,0 +1,15 @@
+# Host checks for the PSoC firmware, run from the repo root after compile.sh
+status=0
+run()
+{
+    echo "== $*"
+    "$@" > /tmp/fw_check.log 2>&1 || { cat /tmp/fw_check.log; status=1; }
+}
+
+run ./planner_test
+run ./mailbox_test 1
+run ./fw_sim psoc_code/host_sim/replays/idle_home.txt --expect 68 4
+run ./fw_sim --demo 20
+
+[ $status -eq 0 ] && echo "all passed"
+exit $status
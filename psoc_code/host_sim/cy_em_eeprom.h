@@ -0,0 +1,40 @@
+#ifndef HOST_SIM_CY_EM_EEPROM_H
+#define HOST_SIM_CY_EM_EEPROM_H
+
+/* Emulated EEPROM API backed by RAM in stubs.c, starts blank every run */
+
+#include "project.h"
+
+#define CY_EM_EEPROM_FLASH_SIZEOF_ROW 256u
+#define CY_EM_EEPROM_GET_PHYSICAL_SIZE(dataSize, wearLeveling, redundantCopy) \
+    ((((dataSize) + CY_EM_EEPROM_FLASH_SIZEOF_ROW / 2 - 1) / (CY_EM_EEPROM_FLASH_SIZEOF_ROW / 2)) * \
+     CY_EM_EEPROM_FLASH_SIZEOF_ROW * (wearLeveling) * (1u + (redundantCopy)))
+
+typedef struct
+{
+    uint32 eepromSize;
+    uint32 wearLevelingFactor;
+    uint8 redundantCopy;
+    uint8 blockingWrite;
+    uint32 userFlashStartAddr;
+} cy_stc_eeprom_config_t;
+
+typedef struct
+{
+    uint32 eepromSize;
+} cy_stc_eeprom_context_t;
+
+typedef enum
+{
+    CY_EM_EEPROM_SUCCESS = 0,
+    CY_EM_EEPROM_BAD_PARAM,
+    CY_EM_EEPROM_BAD_CHECKSUM,
+    CY_EM_EEPROM_BAD_DATA,
+    CY_EM_EEPROM_WRITE_FAIL
+} cy_en_em_eeprom_status_t;
+
+cy_en_em_eeprom_status_t Cy_Em_EEPROM_Init(cy_stc_eeprom_config_t *config, cy_stc_eeprom_context_t *context);
+cy_en_em_eeprom_status_t Cy_Em_EEPROM_Read(uint32 addr, void *eepromData, uint32 size, cy_stc_eeprom_context_t *context);
+cy_en_em_eeprom_status_t Cy_Em_EEPROM_Write(uint32 addr, void *eepromData, uint32 size, cy_stc_eeprom_context_t *context);
+
+#endif
@@ -0,0 +1,9 @@
+#ifndef HOST_SIM_CYFITTER_H
+#define HOST_SIM_CYFITTER_H
+
+/* Stand-in for the PSoC Creator generated cyfitter.h, with just the clock
+   the firmware derives its timing from. Keep it matching the .cydwr. */
+
+#define BCLK__BUS_CLK__HZ 24000000U
+
+#endif /* HOST_SIM_CYFITTER_H */
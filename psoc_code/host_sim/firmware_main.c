@@ -0,0 +1,3 @@
+/* The firmware's main.c as is, with main() renamed so fw_sim.c can drive it */
+#define main firmware_main
+#include "main.c"
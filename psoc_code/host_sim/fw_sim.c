@@ -0,0 +1,192 @@
+#include "sim.h"
+#include "stepper.h"
+#include "params.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/* Runs the PSoC firmware on the host against the models in stubs.c.
+
+   usage: fw_sim [replay | --demo seconds] [--seed n] [--start x y] [--trace steps.csv] [--expect x y]
+
+   A replay file has one input per line, times in seconds from power on
+   (the firmware waits 1 s before it listens):
+       t b0 b1 b2 b3    4-byte packet on the UART, as main.cpp or a param command sends it
+       t reset          pos_reset fires
+   The firmware homes first and ignores targets until then, a few seconds.
+   --demo sends a random target at 90 fps instead, jumping every 10 frames.
+   --start puts the gantry somewhere other than (60, 50) px at power on.
+   --trace writes cycle,motor,position for every step pulse.
+   --expect exits 1 unless the gantry ends up at pixel (x, y).
+   At the end it prints the step ISR's run time and how often and how long
+   the main loop kept it masked, which is how late it can make it start.
+   Regression replays are in replays/, check.sh runs them. */
+
+#define FRAME_RATE 90
+#define DEMO_START 5 // After homing [s]
+#define TAIL_TIME 10 // Time allowed after the last input to stop [s]
+
+static uint64 seconds(double t)
+{
+    return (uint64)(t * SIM_HZ);
+}
+
+static uint64 load_replay(const char *path)
+{
+    FILE *f = fopen(path, "r");
+    if (f == NULL)
+    {
+        fprintf(stderr, "Unable to open %s\n", path);
+        exit(2);
+    }
+
+    char line[128];
+    uint64 last = 0;
+    int line_n = 0;
+    while (fgets(line, sizeof(line), f))
+    {
+        line_n++;
+        double t;
+        int b[4], used;
+        if (line[0] == '#' || sscanf(line, "%lf%n", &t, &used) != 1)
+            continue;
+        last = seconds(t);
+        if (strncmp(line + used + strspn(line + used, " \t"), "reset", 5) == 0)
+        {
+            sim_home(last);
+        }
+        else if (sscanf(line + used, "%d %d %d %d", &b[0], &b[1], &b[2], &b[3]) == 4)
+        {
+            uint8 packet[4] = {(uint8)b[0], (uint8)b[1], (uint8)b[2], (uint8)b[3]};
+            sim_uart_send(last, packet, 4);
+        }
+        else
+        {
+            fprintf(stderr, "%s:%d: bad line\n", path, line_n);
+        }
+    }
+    fclose(f);
+    return last;
+}
+
+static uint64 load_demo(double duration, unsigned seed)
+{
+    srand(seed);
+    uint8 packet[4] = {0, 0, 0, 0};
+    int frames = (int)(duration * FRAME_RATE);
+    for (int i = 0; i < frames; i++)
+    {
+        if (i % 10 == 0)
+        {
+            packet[0] = 4 + rand() % 128; // Inside the default soft limits
+            packet[1] = 4 + rand() % 97;
+        }
+        sim_uart_send(seconds(DEMO_START + (double)i / FRAME_RATE), packet, 4);
+    }
+    return seconds(DEMO_START + duration);
+}
+
+static int compare_u32(const void *a, const void *b)
+{
+    uint32 x = *(const uint32 *)a, y = *(const uint32 *)b;
+    return (x > y) - (x < y);
+}
+
+int main(int argc, char **argv)
+{
+    const char *replay = NULL;
+    double demo = 0;
+    unsigned seed = 1;
+    int expect = 0, expect_x = 0, expect_y = 0;
+    sim.start_x = 60;
+    sim.start_y = 50;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "--demo") && i + 1 < argc)
+        {
+            demo = atof(argv[++i]);
+        }
+        else if (!strcmp(argv[i], "--seed") && i + 1 < argc)
+        {
+            seed = atoi(argv[++i]);
+        }
+        else if (!strcmp(argv[i], "--trace") && i + 1 < argc)
+        {
+            sim.trace = fopen(argv[++i], "w");
+            if (sim.trace == NULL)
+            {
+                fprintf(stderr, "Unable to open %s\n", argv[i]);
+                return 2;
+            }
+            fprintf(sim.trace, "cycle,motor,position\n");
+        }
+        else if (!strcmp(argv[i], "--start") && i + 2 < argc)
+        {
+            sim.start_x = atoi(argv[++i]);
+            sim.start_y = atoi(argv[++i]);
+        }
+        else if (!strcmp(argv[i], "--expect") && i + 2 < argc)
+        {
+            expect = 1;
+            expect_x = atoi(argv[++i]);
+            expect_y = atoi(argv[++i]);
+        }
+        else if (argv[i][0] != '-')
+        {
+            replay = argv[i];
+        }
+        else
+        {
+            fprintf(stderr, "usage: fw_sim [replay | --demo seconds] [--seed n] [--start x y] [--trace steps.csv] [--expect x y]\n");
+            return 2;
+        }
+    }
+
+    uint64 last = replay ? load_replay(replay) : load_demo(demo > 0 ? demo : 10, seed);
+    uint8 stopped = sim_run(last + seconds(TAIL_TIME));
+    printf("\n");
+
+    if (sim.trace)
+        fclose(sim.trace);
+
+    int32 m1, m2;
+    stepper_position(&m1, &m2);
+    int16 spp = param[PARAM_STEPS_PER_PIXEL];
+    printf("Time: %.3f s\tSteps: %llu\tPosition: (%d, %d) steps, (%.2f, %.2f) px\n",
+           (double)sim.now / SIM_HZ, (unsigned long long)sim.steps, sim.m1, sim.m2,
+           -(sim.m1 + sim.m2) / (2.0 * spp), (sim.m1 - sim.m2) / (2.0 * spp));
+    printf("Max step rate: m1 %.0f Hz\tm2 %.0f Hz\n",
+           sim.m1_gap_min == UINT64_MAX ? 0 : (double)SIM_HZ / sim.m1_gap_min,
+           sim.m2_gap_min == UINT64_MAX ? 0 : (double)SIM_HZ / sim.m2_gap_min);
+    printf("pulse_ready_isr: %llu calls\tmean %.0f ns\tmax %llu ns (host)\n",
+           (unsigned long long)sim.isr_calls, sim.isr_calls ? (double)sim.isr_ns_sum / sim.isr_calls : 0.0,
+           (unsigned long long)sim.isr_ns_max);
+    printf("main loop: %llu wakes\n", (unsigned long long)sim.wakes);
+    if (sim.held > 0)
+    {
+        // The host preempts the odd span, so the max is noise and the percentile is the figure
+        qsort(sim.held_ns, sim.held, sizeof(uint32), compare_u32);
+        printf("pulse_ready_isr masked by it: %llu times\tmedian %u ns\t99.9%% %u ns\tmax %u ns (host)\n",
+               (unsigned long long)sim.held, sim.held_ns[sim.held / 2], sim.held_ns[sim.held * 999 / 1000],
+               sim.held_ns[sim.held - 1]);
+    }
+
+    int failed = 0;
+    if (!stopped)
+    {
+        printf("FAIL: still moving %d s after the last input\n", TAIL_TIME);
+        failed = 1;
+    }
+    if (m1 != sim.m1 || m2 != sim.m2)
+    {
+        printf("FAIL: firmware thinks it is at (%d, %d) steps\n", m1, m2);
+        failed = 1;
+    }
+    if (expect && (sim.m1 != -(expect_x - expect_y) * spp || sim.m2 != -(expect_x + expect_y) * spp))
+    {
+        printf("FAIL: expected (%d, %d) px\n", expect_x, expect_y);
+        failed = 1;
+    }
+    return failed;
+}
@@ -0,0 +1,135 @@
+#define _GNU_SOURCE
+#include "mailbox.h"
+
+#include <pthread.h>
+#include <sched.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+/* Stress test for the target mailbox, the main thread reading as the main
+   loop does against two kinds of writer:
+       thread  a thread calling mailbox_write flat out, pinned to another
+               core when there is one, otherwise preempted in and out
+       isr     a 20 us POSIX timer whose signal handler writes, which
+               interrupts the reader at any instruction and runs to the
+               end first, as isr_rx does on the PSoC
+
+   usage: mailbox_test [seconds per writer]
+
+   Every target written carries its sequence number in x and a check
+   pattern in y, so a read that mixes two writes, or comes back with the
+   wrong sequence number, is caught. Exits 1 on any. */
+
+#define DEFAULT_SECONDS 2
+#define ISR_PERIOD_NS 20000
+
+static mailbox mb;
+static volatile int done = 0;
+static volatile uint32_t written = 0;
+
+static int16_t pattern(int16_t x)
+{
+    return (int16_t)(x ^ 0x5A5A);
+}
+
+static void write_next(void)
+{
+    uint32_t seq = written + 1;
+    mailbox_write(&mb, (int16_t)seq, pattern((int16_t)seq));
+    written = seq;
+}
+
+static void pin(int cpu)
+{
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+}
+
+static void *writer_thread(void *arg)
+{
+    if (arg != NULL)
+        pin(1);
+    while (!done)
+        write_next();
+    return NULL;
+}
+
+static void writer_isr(int sig)
+{
+    (void)sig;
+    write_next();
+}
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// Reads for the given time, returns the number of bad reads
+static long read_for(const char *name, double seconds)
+{
+    long reads = 0, torn = 0, wrong_seq = 0, backwards = 0, fresh = 0;
+    uint32_t last = 0;
+    double end = now() + seconds;
+
+    while ((reads & 0xFFFF) != 0 || now() < end)
+    {
+        target t;
+        uint32_t seq = mailbox_read(&mb, &t);
+        reads++;
+        if (seq == 0)
+            continue; // Nothing written yet
+        if (t.y != pattern(t.x))
+            torn++;
+        else if (t.x != (int16_t)seq)
+            wrong_seq++;
+        if (seq < last)
+            backwards++;
+        fresh += seq != last;
+        last = seq;
+    }
+
+    printf("%-6s %ld reads, %ld new targets, %u written\ttorn %ld\twrong seq %ld\tbackwards %ld\n", name, reads,
+           fresh, written, torn, wrong_seq, backwards);
+    return torn + wrong_seq + backwards;
+}
+
+int main(int argc, char **argv)
+{
+    double seconds = argc > 1 ? atof(argv[1]) : DEFAULT_SECONDS;
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    long bad = 0;
+
+    // Writer on another thread, on another core if there is one
+    if (cores > 1)
+        pin(0);
+    pthread_t thread;
+    pthread_create(&thread, NULL, writer_thread, cores > 1 ? (void *)1 : NULL);
+    printf("%ld cores\n", cores);
+    bad += read_for("thread", seconds);
+    done = 1;
+    pthread_join(thread, NULL);
+
+    // Writer interrupting the reader
+    mb.seq = 0;
+    written = 0;
+    signal(SIGALRM, writer_isr);
+    timer_t timer;
+    struct sigevent ev = {0};
+    ev.sigev_notify = SIGEV_SIGNAL;
+    ev.sigev_signo = SIGALRM;
+    struct itimerspec period = {{0, ISR_PERIOD_NS}, {0, ISR_PERIOD_NS}};
+    timer_create(CLOCK_MONOTONIC, &ev, &timer);
+    timer_settime(timer, 0, &period, NULL);
+    bad += read_for("isr", seconds);
+    timer_delete(timer);
+
+    return bad != 0;
+}
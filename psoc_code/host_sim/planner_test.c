@@ -0,0 +1,261 @@
+#include "planner.h"
+
+#include <math.h>
+#include <stdio.h>
+
+/* Checks the lookahead planner on the host, built with planner.c alone.
+
+   usage: planner_test
+
+   Prints a line per failed check and exits 1 if any failed. */
+
+#define V 2400.0f // Cruise speed for every move [steps/s]
+
+static int failures = 0;
+
+#define CHECK(cond, ...)                                \
+    do                                                  \
+    {                                                   \
+        if (!(cond))                                    \
+        {                                               \
+            printf("FAIL %s:%d: ", __func__, __LINE__); \
+            printf(__VA_ARGS__);                        \
+            printf("\n");                               \
+            failures++;                                 \
+        }                                               \
+    } while (0)
+
+// Planning calls as stepper.c makes them, on a copy swapped in afterwards
+static void clear(int32_t m1, int32_t m2)
+{
+    planner_begin();
+    planner_clear(m1, m2);
+    planner_commit();
+}
+
+static uint8_t add(int32_t m1, int32_t m2, float v)
+{
+    planner_begin();
+    uint8_t queued = planner_add(m1, m2, v);
+    planner_commit();
+    return queued;
+}
+
+static uint8_t retarget(uint32_t tick, uint32_t n, int32_t m1, int32_t m2, float v)
+{
+    planner_begin();
+    uint8_t queued = planner_retarget(tick, n, m1, m2, v);
+    planner_commit();
+    return queued;
+}
+
+// Queued segment i from the oldest. The tests start from planner_clear and
+// discard at most one, so the queue never wraps in the ring.
+static segment *queued(uint8_t i)
+{
+    return planner_current() + i;
+}
+
+// Ramp index at the slowest tick rate, what the planner exits at to stop
+static uint32_t rest_n(const segment *s)
+{
+    float f = PLANNER_TIMER_HZ * (1 << PLANNER_C_SHIFT);
+    uint32_t rest_c = (uint32_t)(f / PLANNER_MIN_RATE);
+    return (uint32_t)(s->n_num / ((uint64_t)rest_c * rest_c));
+}
+
+// Every planned speed has to be reachable from its neighbours within accel
+// and the newest segment has to end at rest
+static void check_ramps(void)
+{
+    uint8_t i, count = planner_count();
+    for (i = 0; i < count; i++)
+    {
+        segment *s = queued(i);
+        float exit_v = i + 1 < count ? queued(i + 1)->entry_v : 0;
+        float dv2 = 2 * PLANNER_ACCEL * s->length * 1.001f + 1;
+        CHECK(s->entry_v <= s->max_entry_v + 0.01f, "segment %d enters at %.1f over its junction limit %.1f", i,
+              s->entry_v, s->max_entry_v);
+        CHECK(s->entry_v * s->entry_v <= exit_v * exit_v + dv2, "segment %d cannot brake from %.1f to %.1f", i,
+              s->entry_v, exit_v);
+        CHECK(exit_v * exit_v <= s->entry_v * s->entry_v + dv2, "segment %d cannot reach %.1f from %.1f", i, exit_v,
+              s->entry_v);
+    }
+
+    segment *last = queued(count - 1);
+    CHECK(last->exit_n <= rest_n(last), "newest segment exits at n = %u, not at rest", last->exit_n);
+}
+
+static void junction_collinear(void)
+{
+    clear(0, 0);
+    add(1000, -1000, V);
+    add(3000, -3000, V);
+
+    segment *s = queued(1);
+    CHECK(fabsf(s->max_entry_v - s->nominal_v) < 0.01f, "straight on limited to %.1f, cruise is %.1f",
+          s->max_entry_v, s->nominal_v);
+    CHECK(s->entry_v > 0.9f * s->nominal_v, "straight on entered at %.1f", s->entry_v);
+    check_ramps();
+}
+
+static void junction_corner(void)
+{
+    clear(0, 0);
+    add(1000, -1000, V);
+    add(2000, 0, V); // 90 degrees
+
+    segment *s = queued(1);
+    CHECK(s->max_entry_v > 0 && s->max_entry_v < s->nominal_v, "right angle limited to %.1f", s->max_entry_v);
+    check_ramps();
+}
+
+static void junction_reversal(void)
+{
+    clear(0, 0);
+    add(1000, -1000, V);
+    add(0, 0, V);
+
+    segment *s = queued(1);
+    CHECK(s->max_entry_v == 0 && s->entry_v == 0, "reversal entered at %.1f, limit %.1f", s->entry_v,
+          s->max_entry_v);
+    CHECK(queued(0)->exit_n <= rest_n(queued(0)), "first segment exits at n = %u before reversing", queued(0)->exit_n);
+    check_ramps();
+}
+
+static void brakes_at_end(void)
+{
+    // Short moves one after another, none long enough to reach cruise
+    clear(0, 0);
+    for (int32_t i = 1; i <= 5; i++)
+        add(40 * i, -40 * i, V);
+    check_ramps();
+
+    // Adding one more lifts the exit of the one before it off rest
+    float before = queued(4)->entry_v;
+    add(240, -240, V);
+    CHECK(queued(4)->entry_v >= before, "entry %.1f dropped to %.1f when the queue grew", before,
+          queued(4)->entry_v);
+    check_ramps();
+}
+
+static void ring_full(void)
+{
+    int32_t i;
+
+    clear(0, 0);
+    for (i = 1; i < PLANNER_SIZE; i++)
+        CHECK(add(100 * i, 0, V) == 1, "segment %d refused", i);
+    CHECK(planner_count() == PLANNER_SIZE - 1, "%d queued", planner_count());
+
+    // One slot is kept free to tell full from empty
+    CHECK(add(100 * PLANNER_SIZE, 0, V) == 0, "segment %d accepted into a full ring", PLANNER_SIZE);
+    CHECK(planner_count() == PLANNER_SIZE - 1, "%d queued after a refused add", planner_count());
+    CHECK(add(100 * (PLANNER_SIZE - 1), 0, V) == 1, "zero length move refused while full");
+    check_ramps();
+
+    // Once the oldest is stepped there is room again, and the refused
+    // target did not move where the next one starts from
+    planner_discard();
+    CHECK(add(100 * PLANNER_SIZE, 0, V) == 1, "refused after a slot freed up");
+    segment *s = queued(PLANNER_SIZE - 2);
+    CHECK(s->start_m1 == 100 * (PLANNER_SIZE - 1) && s->m1 == 100, "wrapped segment starts at %d, %d long",
+          s->start_m1, s->m1);
+}
+
+static void retarget_inside_segment(void)
+{
+    clear(0, 0);
+    add(4000, -4000, V);
+    float entry = queued(0)->entry_v;
+
+    // Stepped 1000 ticks in, 300 to brake: the cut is at tick 1300
+    CHECK(retarget(1000, 300, 4000, 0, V) == 1, "retarget refused");
+    CHECK(planner_count() == 2, "%d queued", planner_count());
+    segment *s = queued(0);
+    CHECK(s->ticks == 1300, "cut at tick %u, not 1300", s->ticks);
+    CHECK(s->entry_v == entry, "entry of the segment being stepped changed");
+
+    segment *t = queued(1);
+    CHECK(t->start_m1 == 1300 && t->start_m2 == -1300, "new move starts at (%d, %d)", t->start_m1, t->start_m2);
+    CHECK(t->start_m1 + t->m1 == 4000 && t->start_m2 + t->m2 == 0, "new move ends at (%d, %d)",
+          t->start_m1 + t->m1, t->start_m2 + t->m2);
+    check_ramps();
+}
+
+static void retarget_across_segments(void)
+{
+    clear(0, 0);
+    add(1000, -1000, V);
+    add(3000, -3000, V);
+    add(3000, 0, V);
+
+    // 100 ticks left in the first, 400 to brake: 300 into the second
+    CHECK(retarget(900, 400, 0, 0, V) == 1, "retarget refused");
+    CHECK(planner_count() == 3, "%d queued", planner_count());
+    CHECK(queued(0)->ticks == 1000, "first segment cut to %u", queued(0)->ticks);
+    CHECK(queued(1)->ticks == 300, "second segment cut to %u, not 300", queued(1)->ticks);
+
+    segment *t = queued(2);
+    CHECK(t->start_m1 == 1300 && t->start_m2 == -1300, "new move starts at (%d, %d)", t->start_m1, t->start_m2);
+    CHECK(t->max_entry_v == 0, "reversal at the cut entered at %.1f", t->max_entry_v);
+    check_ramps();
+}
+
+static void retarget_past_end(void)
+{
+    clear(0, 0);
+    add(1000, -1000, V);
+
+    // Braking distance past the end of the queue, which ends at rest anyway
+    CHECK(retarget(900, 500, 2000, -2000, V) == 1, "retarget refused");
+    CHECK(planner_count() == 2, "%d queued", planner_count());
+    CHECK(queued(0)->ticks == 1000, "segment cut to %u", queued(0)->ticks);
+    check_ramps();
+
+    // A target right where the cut lands only brakes
+    clear(0, 0);
+    add(4000, -4000, V);
+    CHECK(retarget(1000, 300, 1300, -1300, V) == 1, "retarget refused");
+    CHECK(planner_count() == 1 && queued(0)->ticks == 1300, "%d queued, cut to %u", planner_count(),
+          queued(0)->ticks);
+    check_ramps();
+}
+
+static void commit_after_discard(void)
+{
+    clear(0, 0);
+    add(1000, -1000, V);
+    add(2000, -2000, V);
+
+    // The step ISR finishes the first segment while the next target is planned
+    planner_begin();
+    planner_add(2000, 0, V);
+    planner_discard();
+    CHECK(planner_commit() == 0, "plan from a finished segment swapped in");
+    CHECK(planner_count() == 1 && queued(0)->start_m1 == 1000, "%d queued, oldest from %d", planner_count(),
+          queued(0)->start_m1);
+
+    // Planned again from where the ISR is now
+    planner_begin();
+    planner_add(2000, 0, V);
+    CHECK(planner_commit() == 1, "fresh plan refused");
+    CHECK(planner_count() == 2, "%d queued", planner_count());
+    check_ramps();
+}
+
+int main(void)
+{
+    junction_collinear();
+    junction_corner();
+    junction_reversal();
+    brakes_at_end();
+    ring_full();
+    retarget_inside_segment();
+    retarget_across_segments();
+    retarget_past_end();
+    commit_after_discard();
+
+    printf(failures ? "%d failed\n" : "all passed\n", failures);
+    return failures != 0;
+}
@@ -0,0 +1,73 @@
+#ifndef HOST_SIM_PROJECT_H
+#define HOST_SIM_PROJECT_H
+
+/* Stand-in for the PSoC Creator generated project.h, declaring just the
+   component APIs the firmware uses. Implemented in stubs.c against a
+   virtual BUS_CLK so the firmware sources build and run unchanged on Linux. */
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "cyfitter.h"
+
+typedef uint8_t uint8;
+typedef uint16_t uint16;
+typedef uint32_t uint32;
+typedef uint64_t uint64;
+typedef int8_t int8;
+typedef int16_t int16;
+typedef int32_t int32;
+typedef volatile uint8 reg8;
+
+#define CY_ISR(name) void name(void)
+#define CY_ISR_PROTO(name) void name(void)
+typedef void (*cyisraddress)(void);
+
+#define CY_ALIGN(align) __attribute__((aligned(align)))
+
+#define CyGlobalIntEnable sim_global_int(1)
+#define CyGlobalIntDisable sim_global_int(0)
+#define CY_PM_WFI sim_wfi()
+
+#define PROFILE_CYCLES() sim_cycles() // No DWT, ISRs take no virtual time so runs come out 0
+
+void sim_global_int(uint8 enable);
+uint32 sim_cycles(void);
+void sim_wfi(void);
+uint8 CyEnterCriticalSection(void);
+void CyExitCriticalSection(uint8 saved);
+void CyDelay(uint32 ms);
+
+#define SIM_REG(n)              \
+    void n##_Write(uint8 value); \
+    uint8 n##_Read(void);
+SIM_REG(Control_Reg_1)
+SIM_REG(Control_Reg_2)
+SIM_REG(Control_Reg_3)
+SIM_REG(Control_Reg_4)
+SIM_REG(Control_Reg_5)
+SIM_REG(Control_Reg_6)
+
+#define SIM_ISR(n)                          \
+    void n##_StartEx(cyisraddress address); \
+    void n##_Enable(void);                  \
+    void n##_Disable(void);
+SIM_ISR(pulse_ready_isr)
+SIM_ISR(isr_rx)
+SIM_ISR(pos_reset)
+
+void PWM_1_Start(void);
+void PWM_2_Start(void);
+
+void Timer_1_Start(void);
+void Timer_1_Stop(void);
+void Timer_1_WritePeriod(uint16 period);
+uint16 Timer_1_ReadPeriod(void);
+uint16 Timer_1_ReadCounter(void);
+
+void UART_Start(void);
+uint8 UART_GetChar(void);
+
+void Pin_1_ClearInterrupt(void);
+
+#endif
@@ -0,0 +1,59 @@
+#ifndef SIM_H
+#define SIM_H
+
+#include "project.h"
+
+#include <stdio.h>
+
+/************* FIRMWARE SIMULATOR **************
+Hardware models behind the stub component APIs in project.h, on a virtual
+clock counted in BUS_CLK cycles. Virtual time only moves while the firmware
+waits (CY_PM_WFI, CyDelay), so the main loop and the ISRs take none of it,
+and the step ISR's cost is measured in host time instead. So is the time
+the main loop keeps pulse_ready_isr masked, by critical section or by
+disabling it, which is how late it can make the ISR start on the PSoC.
+
+Timer_1 fires pulse_ready_isr every period + 1 cycles. As on the fixed
+function timer, the period register is reloaded at terminal count, so a
+period written in the ISR sets the interval after the one already running.
+Steps are counted off the rising edges of Control_Reg_5 / 6 with the
+direction from Control_Reg_1 / 2, independently of the firmware's count.
+The gantry starts at (start_x, start_y) and the limit switches close at
+the home position in the params, both firing pos_reset.
+*******************************************/
+
+#define SIM_HZ ((uint64)BCLK__BUS_CLK__HZ)
+#define SIM_UART_BYTE (SIM_HZ / 11520) // 10 bits at 115200 baud [cycles]
+
+typedef struct
+{
+    uint64 now;                     // Virtual time [BUS_CLK cycles]
+    int16 start_x, start_y;         // Where the gantry is at power on [px]
+    int32 m1, m2;                   // Position counted off the step and dir registers
+    uint64 steps;                   // Step pulses, both motors
+    uint64 m1_last, m2_last;        // Time of the last step
+    uint64 m1_gap_min, m2_gap_min;  // Shortest time between two steps
+    uint64 isr_calls;               // pulse_ready_isr runs
+    uint64 isr_ns_sum, isr_ns_max;  // Host time spent in pulse_ready_isr
+    uint64 wakes;                   // Main loop returns from WFI
+    uint64 held, held_cap;          // Main loop spans with pulse_ready_isr masked
+    uint32 *held_ns;                // and the host time of each
+    FILE *trace;                    // One line per step pulse if set
+} sim_state;
+
+extern sim_state sim;
+
+// Queues bytes to arrive on UART rx back to back from time t
+void sim_uart_send(uint64 t, const uint8 *bytes, uint8 count);
+
+// Fires pos_reset at time t, as if a limit switch bounced
+void sim_home(uint64 t);
+
+// Runs the firmware until every input has arrived and the gantry has
+// stopped, or until time limit. Returns 0 if it hit the limit.
+uint8 sim_run(uint64 limit);
+
+// Firmware main(), renamed at compile time
+int firmware_main(void);
+
+#endif /* SIM_H */
@@ -0,0 +1,407 @@
+#include "sim.h"
+#include "cy_em_eeprom.h"
+#include "stepper.h"
+#include "events.h"
+#include "params.h"
+
+#include <setjmp.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+sim_state sim;
+
+/************* INPUTS **************/
+typedef struct
+{
+    uint64 t;
+    int16 byte; // -1 for the home switch
+} sim_input;
+
+static sim_input *inputs = 0;
+static size_t input_count = 0, input_cap = 0, input_next = 0;
+static uint64 uart_free = 0; // When the rx line is next idle
+
+static void push_input(uint64 t, int16 byte)
+{
+    if (input_count == input_cap)
+    {
+        input_cap = input_cap ? 2 * input_cap : 1024;
+        inputs = realloc(inputs, input_cap * sizeof(sim_input));
+    }
+    // Arrive in time order, inputs are mostly added that way already
+    size_t i = input_count++;
+    while (i > input_next && inputs[i - 1].t > t)
+    {
+        inputs[i] = inputs[i - 1];
+        i--;
+    }
+    inputs[i].t = t;
+    inputs[i].byte = byte;
+}
+
+void sim_uart_send(uint64 t, const uint8 *bytes, uint8 count)
+{
+    uint8 i;
+    if (t < uart_free)
+        t = uart_free;
+    for (i = 0; i < count; i++)
+    {
+        t += SIM_UART_BYTE;
+        push_input(t, bytes[i]);
+    }
+    uart_free = t;
+}
+
+void sim_home(uint64 t)
+{
+    push_input(t, -1);
+}
+/***********************************/
+
+/************* INTERRUPTS **************/
+enum
+{
+    IRQ_TIMER, // In priority order
+    IRQ_RX,
+    IRQ_HOME,
+    NUM_IRQS
+};
+
+static cyisraddress vector[NUM_IRQS];
+static uint8 irq_enabled[NUM_IRQS], irq_pending[NUM_IRQS];
+static uint8 global_enabled = 0;
+static uint8 looping = 0, asleep = 0, in_isr = 0; // Main loop reached, in WFI, in an ISR
+static uint64 held_since = 0;                     // Host time pulse_ready_isr was masked at, 0 if not
+static uint64 clock_cost = 0;                     // Host time host_ns() itself takes, taken off each span
+
+static uint64 host_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64)ts.tv_sec * 1000000000u + ts.tv_nsec;
+}
+
+// Times the main loop's spans with pulse_ready_isr masked, call on any change
+static void hold_update(void)
+{
+    uint8 held = looping && !asleep && !in_isr && (!global_enabled || !irq_enabled[IRQ_TIMER]);
+    if (held && held_since == 0)
+    {
+        held_since = host_ns();
+    }
+    else if (!held && held_since != 0)
+    {
+        uint64 t = host_ns();
+        uint32 dt = t - held_since > clock_cost ? (uint32)(t - held_since - clock_cost) : 0;
+        if (sim.held == sim.held_cap)
+        {
+            sim.held_cap = sim.held_cap ? 2 * sim.held_cap : 4096;
+            sim.held_ns = realloc(sim.held_ns, sim.held_cap * sizeof(uint32));
+        }
+        sim.held_ns[sim.held++] = dt;
+        held_since = 0;
+    }
+}
+
+#define SIM_ISR_STUB(n, irq)                  \
+    void n##_StartEx(cyisraddress address)    \
+    {                                         \
+        vector[irq] = address;                \
+        irq_pending[irq] = 0;                 \
+    }                                         \
+    void n##_Enable(void)                     \
+    {                                         \
+        irq_enabled[irq] = 1;                 \
+        hold_update();                        \
+    }                                         \
+    void n##_Disable(void)                    \
+    {                                         \
+        irq_enabled[irq] = 0;                 \
+        hold_update();                        \
+    }
+SIM_ISR_STUB(pulse_ready_isr, IRQ_TIMER)
+SIM_ISR_STUB(isr_rx, IRQ_RX)
+SIM_ISR_STUB(pos_reset, IRQ_HOME)
+
+void sim_global_int(uint8 enable)
+{
+    global_enabled = enable;
+    hold_update();
+}
+
+uint8 CyEnterCriticalSection(void)
+{
+    uint8 saved = global_enabled;
+    global_enabled = 0;
+    hold_update();
+    return saved;
+}
+
+void CyExitCriticalSection(uint8 saved)
+{
+    global_enabled = saved;
+    hold_update();
+}
+
+static void run_pending(void)
+{
+    uint8 i;
+    for (i = 0; i < NUM_IRQS; i++)
+    {
+        if (!irq_pending[i] || !irq_enabled[i] || vector[i] == 0)
+            continue;
+        irq_pending[i] = 0;
+        in_isr = 1;
+        if (i == IRQ_TIMER)
+        {
+            uint64 t_0 = host_ns();
+            vector[i]();
+            uint64 dt = host_ns() - t_0;
+            sim.isr_calls++;
+            sim.isr_ns_sum += dt;
+            if (dt > sim.isr_ns_max)
+                sim.isr_ns_max = dt;
+        }
+        else
+        {
+            vector[i]();
+        }
+        in_isr = 0;
+    }
+}
+/***************************************/
+
+static void limit_switches(void);
+
+/************* TIMER_1 **************/
+static uint8 timer_running = 0;
+static uint16 timer_period = 0xFFFF; // Period register
+static uint16 timer_reload = 0xFFFF; // Period the counter is running down from
+static uint64 timer_tc = 0;          // Time of the last terminal count
+
+void Timer_1_Start(void)
+{
+    // The steps per pixel are known by now, put the gantry where it was left
+    sim.m1 = -(sim.start_x - sim.start_y) * param[PARAM_STEPS_PER_PIXEL];
+    sim.m2 = -(sim.start_x + sim.start_y) * param[PARAM_STEPS_PER_PIXEL];
+    limit_switches();
+    timer_running = 1;
+    timer_tc = sim.now;
+    timer_reload = timer_period;
+}
+
+void Timer_1_Stop(void)
+{
+    timer_running = 0;
+}
+
+void Timer_1_WritePeriod(uint16 period)
+{
+    timer_period = period;
+}
+
+uint16 Timer_1_ReadPeriod(void)
+{
+    return timer_period;
+}
+
+uint16 Timer_1_ReadCounter(void)
+{
+    uint64 done = sim.now - timer_tc;
+    return done > timer_reload ? 0 : (uint16)(timer_reload - done);
+}
+
+static uint64 timer_next(void)
+{
+    return timer_running ? timer_tc + timer_reload + 1 : UINT64_MAX;
+}
+/************************************/
+
+/************* UART **************/
+static uint8 rx_fifo[4];
+static uint8 rx_count = 0;
+
+void UART_Start(void)
+{
+}
+
+uint8 UART_GetChar(void)
+{
+    if (rx_count == 0)
+        return 0;
+    uint8 byte = rx_fifo[0];
+    rx_count--;
+    memmove(rx_fifo, rx_fifo + 1, rx_count);
+    return byte;
+}
+/*********************************/
+
+/************* CONTROL REGISTERS **************/
+static uint8 reg[7];
+static uint8 switch_closed = 0;
+
+// Limit switches at the home position, wired together onto Pin_1
+static void limit_switches(void)
+{
+    int32 spp = param[PARAM_STEPS_PER_PIXEL];
+    uint8 closed = -(sim.m1 + sim.m2) <= 2 * param[PARAM_HOME_X] * spp || sim.m1 - sim.m2 <= 2 * param[PARAM_HOME_Y] * spp;
+    if (closed && !switch_closed)
+        irq_pending[IRQ_HOME] = 1;
+    switch_closed = closed;
+}
+
+static void step(uint8 dir, int32 *pos, uint64 *last, uint64 *gap_min, uint8 motor)
+{
+    *pos += dir ? 1 : -1; // Dir 1 is the firmware's positive count
+    if (*last != 0 && sim.now - *last < *gap_min)
+        *gap_min = sim.now - *last;
+    *last = sim.now;
+    sim.steps++;
+    limit_switches();
+    if (sim.trace)
+        fprintf(sim.trace, "%llu,%u,%d\n", (unsigned long long)sim.now, motor, *pos);
+}
+
+#define SIM_REG_STUB(i, on_write)         \
+    void Control_Reg_##i##_Write(uint8 v) \
+    {                                     \
+        uint8 was = reg[i];               \
+        reg[i] = v;                       \
+        on_write;                         \
+    }                                     \
+    uint8 Control_Reg_##i##_Read(void)    \
+    {                                     \
+        return reg[i];                    \
+    }
+SIM_REG_STUB(1, (void)was)
+SIM_REG_STUB(2, (void)was)
+SIM_REG_STUB(3, (void)was)
+SIM_REG_STUB(4, (void)was)
+SIM_REG_STUB(5, if (v && !was) step(reg[1], &sim.m1, &sim.m1_last, &sim.m1_gap_min, 1))
+SIM_REG_STUB(6, if (v && !was) step(reg[2], &sim.m2, &sim.m2_last, &sim.m2_gap_min, 2))
+
+void PWM_1_Start(void)
+{
+}
+
+void PWM_2_Start(void)
+{
+}
+
+void Pin_1_ClearInterrupt(void)
+{
+}
+/**********************************************/
+
+/************* EMULATED EEPROM **************/
+static uint8 eeprom[CY_EM_EEPROM_FLASH_SIZEOF_ROW];
+
+cy_en_em_eeprom_status_t Cy_Em_EEPROM_Init(cy_stc_eeprom_config_t *config, cy_stc_eeprom_context_t *context)
+{
+    if (config->eepromSize > sizeof(eeprom))
+        return CY_EM_EEPROM_BAD_PARAM;
+    context->eepromSize = config->eepromSize;
+    return CY_EM_EEPROM_SUCCESS;
+}
+
+cy_en_em_eeprom_status_t Cy_Em_EEPROM_Read(uint32 addr, void *eepromData, uint32 size, cy_stc_eeprom_context_t *context)
+{
+    if (addr + size > context->eepromSize)
+        return CY_EM_EEPROM_BAD_PARAM;
+    memcpy(eepromData, eeprom + addr, size);
+    return CY_EM_EEPROM_SUCCESS;
+}
+
+cy_en_em_eeprom_status_t Cy_Em_EEPROM_Write(uint32 addr, void *eepromData, uint32 size, cy_stc_eeprom_context_t *context)
+{
+    if (addr + size > context->eepromSize)
+        return CY_EM_EEPROM_BAD_PARAM;
+    memcpy(eeprom + addr, eepromData, size);
+    return CY_EM_EEPROM_SUCCESS;
+}
+/********************************************/
+
+/************* VIRTUAL CLOCK **************/
+static jmp_buf stop;
+static uint64 time_limit;
+
+void CyDelay(uint32 ms)
+{
+    sim.now += ms * SIM_HZ / 1000;
+    // Nothing runs meanwhile, a timer that was already going just catches up
+    while (timer_next() <= sim.now)
+    {
+        timer_tc = timer_next();
+        timer_reload = timer_period;
+    }
+}
+
+uint32 sim_cycles(void)
+{
+    return (uint32)sim.now;
+}
+
+void sim_wfi(void)
+{
+    looping = asleep = 1;
+    hold_update(); // Masked while asleep delays nothing
+
+    if (input_next == input_count && rx_count == 0 && events == 0 && !stepper_busy())
+        longjmp(stop, 1);
+
+    uint64 t = timer_next();
+    if (input_next < input_count && inputs[input_next].t < t)
+        t = inputs[input_next].t;
+    if (t > time_limit)
+        longjmp(stop, 2);
+    sim.now = t;
+
+    if (timer_next() == t)
+    {
+        timer_tc = t;
+        timer_reload = timer_period; // Reloaded at terminal count, before the ISR runs
+        irq_pending[IRQ_TIMER] = 1;
+    }
+    while (input_next < input_count && inputs[input_next].t == t)
+    {
+        sim_input *in = &inputs[input_next++];
+        if (in->byte < 0)
+        {
+            irq_pending[IRQ_HOME] = 1;
+        }
+        else
+        {
+            if (rx_count < sizeof(rx_fifo))
+                rx_fifo[rx_count++] = (uint8)in->byte; // Overrun drops it, as on the UART
+            irq_pending[IRQ_RX] = 1;
+        }
+    }
+
+    // WFI returns with interrupts masked and they run as soon as the main
+    // loop unmasks them, before it does anything else
+    sim.wakes++;
+    run_pending();
+    asleep = 0;
+    hold_update();
+}
+
+uint8 sim_run(uint64 limit)
+{
+    uint16 i;
+    clock_cost = UINT64_MAX;
+    for (i = 0; i < 1000; i++)
+    {
+        uint64 t = host_ns(), dt = host_ns() - t;
+        if (dt < clock_cost)
+            clock_cost = dt;
+    }
+
+    time_limit = limit;
+    sim.m1_gap_min = sim.m2_gap_min = UINT64_MAX;
+    int why = setjmp(stop);
+    if (why == 0)
+        firmware_main(); // Never returns, sim_wfi jumps back here
+    return why == 1;
+}
+/******************************************/
@@ -21,7 +21,11 @@ import matplotlib.pyplot as plt
 from matplotlib.patches import Rectangle
 from matplotlib.figure import Figure
 
-import serial
+import atexit
+import mmap
+import os
+import socket
+import struct
 import time
 
 from pyqtgraph.Qt import QtGui, QtCore
@@ -31,7 +35,51 @@ import collections
 import random
 import math
 
-global ser
+# Telemetry bus to main.cpp, see include/Telemetry.h. The UART is left to the motor link.
+TELEMETRY_PATH = '/tmp/bairhockey.sock'
+TELEM_SUBSCRIBE = 1
+TELEM_UNSUBSCRIBE = 2
+TELEM_COMMAND = 3
+TELEM_FRAME = 16
+TELEM_STATS = 17
+FRAME_FORMAT = '<BBBB4bQI5f'  # TelemetryFrame
+STATS_FORMAT = '<B3x8If'  # TelemetryStats
+
+# Every frame's TelemetryFrame in shared memory, see include/TrackRing.h
+TRACK_RING_PATH = '/dev/shm/bairhockey_track'
+TRACK_RING_MAGIC = 0x4B435254
+TRACK_RING_HEADER = 64
+TRACK_RATE = 90  # Records per second
+
+global bus
+send_error = None
+
+
+def send(msg_type, value=0):
+    # main.cpp may not be running yet, the subscription is retried, so each
+    # failure is only logged when it changes
+    global send_error
+    try:
+        bus.sendto(struct.pack('<BB', msg_type, value), TELEMETRY_PATH)
+        send_error = None
+    except OSError as e:
+        if str(e) != send_error:
+            print('Unable to send to %s: %s' % (TELEMETRY_PATH, e))
+            send_error = str(e)
+
+
+def command(cmd):
+    send(TELEM_COMMAND, ord(cmd))
+
+
+def close_bus(bus_path):
+    # Socket files outlive the process, remove ours rather than leave it in /tmp
+    send(TELEM_UNSUBSCRIBE)
+    bus.close()
+    try:
+        os.unlink(bus_path)
+    except OSError:
+        pass
 
 
 class MainWindow(QMainWindow):
@@ -47,9 +95,15 @@ class MainWindow(QMainWindow):
         self.title = "Bair Hockey"
         self.initUI()
 
-        global ser
-        ser = serial.Serial(port='/dev/ttyS0', baudrate=115200)
-        ser.flushOutput()
+        global bus
+        bus = socket.socket(socket.AF_UNIX, socket.SOCK_DGRAM)
+        bus_path = '/tmp/bairhockey-gui-%d.sock' % os.getpid()
+        if os.path.exists(bus_path):
+            os.unlink(bus_path)
+        bus.bind(bus_path)
+        bus.setblocking(False)
+        atexit.register(close_bus, bus_path)
+        send(TELEM_SUBSCRIBE)
         # self.fig, self.ax = plt.subplots(1)
 
         # setting frameless window
@@ -137,29 +191,19 @@ class MainWindow(QMainWindow):
         self.move(self.puck_x, self.puck_y)
 
     def easy(self):
-        diff = b'0'
-        # print(diff)
-        print(ser.write(diff))
+        command('0')
 
     def medium(self):
-        diff = b'1'
-        # print(diff)
-        ser.write(diff)
+        command('1')
 
     def hard(self):
-        diff = b'2'
-        # print(diff)
-        ser.write(diff)
+        command('2')
 
     def start(self):
-        init = b'3'
-        # print("start")
-        ser.write(init)
+        command('3')
 
     def stop(self):
-        stop = b'4'
-        # print("start")
-        ser.write(stop)
+        command('4')
 
     def u_add(self):
         self.u_score += 1
@@ -253,14 +297,65 @@ class LoserPopUp(QDialog):
         #
 
 
+class TrackRing():
+    # Reader for main.cpp's track ring, starts at the newest record
+
+    def __init__(self):
+        self.map = None
+        self.cursor = 0
+        self.lost = 0
+
+    def open(self):
+        try:
+            with open(TRACK_RING_PATH, 'rb') as f:
+                self.map = mmap.mmap(f.fileno(), 0, access=mmap.ACCESS_READ)
+        except (OSError, ValueError):
+            self.map = None
+            return False
+        magic, self.size, record_size, self.cursor = struct.unpack_from('<4I', self.map, 0)
+        if magic != TRACK_RING_MAGIC or record_size != struct.calcsize(FRAME_FORMAT):
+            self.map = None
+            return False
+        self.record_size = record_size
+        return True
+
+    def head(self):
+        return struct.unpack_from('<I', self.map, 12)[0]
+
+    def busy(self):
+        # Records the writer has started on, head + 1 mid-copy
+        return struct.unpack_from('<I', self.map, 16)[0]
+
+    def read(self):
+        # Every record since the last call, oldest first
+        records = []
+        if self.map is None:
+            return records
+        head = self.head()
+        behind = (head - self.cursor) & 0xFFFFFFFF
+        if behind > self.size:
+            self.lost += behind - self.size
+            self.cursor = (head - self.size) & 0xFFFFFFFF
+        while self.cursor != head:
+            offset = TRACK_RING_HEADER + (self.cursor % self.size) * self.record_size
+            record = struct.unpack_from(FRAME_FORMAT, self.map, offset)
+            # Overwritten while we read it if the writer has started on its slot again
+            if (self.busy() - self.cursor) & 0xFFFFFFFF <= self.size:
+                records.append(record)
+            else:
+                self.lost += 1
+            self.cursor = (self.cursor + 1) & 0xFFFFFFFF
+        return records
+
+
 class DynamicPlotter():
 
     def __init__(self, sampleinterval=0.1, timewindow=10., size=(600, 350)):
         # Data stuff
-        global ser
-        self.recv_buf = [0, 0, 0, 0]
+        self.last_track = 0
+        self.track = TrackRing()
         self._interval = int(sampleinterval*1000)
-        self._bufsize = int(timewindow/sampleinterval)
+        self._bufsize = int(timewindow*TRACK_RATE)  # Every frame, not one per poll
         self.databuffer = collections.deque([0.0]*self._bufsize, self._bufsize)
         self.x = np.linspace(-timewindow, 0.0, self._bufsize)
         self.y = np.zeros(self._bufsize, dtype=np.float)
@@ -290,30 +385,37 @@ class DynamicPlotter():
         self.app.processEvents()
 
     def getData(self):
-        if ser.inWaiting() > 3:
-            buf = ser.read(4)
-            ser.flushInput()
-            int_buf = int.from_bytes(buf, byteorder='big')
-            val = self.conv(int_buf)
-            self.databuffer.append(val)
+        # Stats every audit window off the socket, every frame off the track ring
+        while True:
+            try:
+                msg = bus.recv(64)
+            except BlockingIOError:
+                break
+            if msg[0] == TELEM_STATS and len(msg) == struct.calcsize(STATS_FORMAT):
+                (_, frames, dropped, skipped, repeated, misses,
+                 allocs, faults_major, faults_minor, worst_ms) = struct.unpack(STATS_FORMAT, msg)
+                print('frames %d dropped %d skipped %d deadline misses %d worst %.1f ms'
+                      % (frames, dropped, skipped, misses, worst_ms))
+
+        records = self.track.read()
+        if records:
+            self.last_track = time.time()
+        elif time.time() - self.last_track > 1:
+            # main.cpp stopped, restarted or not up yet. A restart makes a new
+            # ring and forgets subscribers, a repeated subscription is ignored.
+            self.track.open()
+            send(TELEM_SUBSCRIBE)
+            self.last_track = time.time()
+
+        for (_, found, waiting, difficulty, pad_x, pad_y, puck_x, puck_y,
+             t_ns, seq, self.puck_x, self.puck_y, v_x, v_y, x_pred) in records:
+            if found:
+                self.databuffer.append(self.puck_y)
+        if records:
             self.y[:] = self.databuffer
             self.curve.setData(self.x, self.y)
             self.app.processEvents()
 
-    def conv(self, data):
-        data = data % 4294967296
-        self.puck_y = data % 256
-        data = data/256
-        self.puck_x = data % 256
-        data = data/256
-        self.pad_y = data % 256
-        self.pad_x = data/256
-        if self.puck_x > 250:
-            self.puck_x = 0
-        if self.puck_y > 250:
-            self.puck_y = 0
-        return self.puck_y
-
     def run(self):
         self.app.exec_()
 
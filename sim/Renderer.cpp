@@ -0,0 +1,73 @@
+#include <Renderer.h>
+#include <Vision.h>
+
+using namespace std;
+using namespace cv;
+
+#define NOISE_BANK_SIZE 16 // Precomputed noise frames, cycled through
+#define DRAW_SHIFT 4        // Fractional bits for sub-pixel drawing
+
+static Point subPixel(Point2f p)
+{
+    return Point(cvRound(p.x * (1 << DRAW_SHIFT)), cvRound(p.y * (1 << DRAW_SHIFT)));
+}
+
+// Translation by (x, y) as a 3 x 3 homogeneous matrix
+static Mat translation(double x, double y)
+{
+    Mat t = Mat::eye(3, 3, CV_64F);
+    t.at<double>(0, 2) = x;
+    t.at<double>(1, 2) = y;
+    return t;
+}
+
+Renderer::Renderer(const Mat &homography, const RenderParams &params, uint64_t seed)
+    : params(params)
+{
+    // findPuck() crops ROI_1, warps with the homography, then crops ROI_2. Undo that.
+    corrected_to_raw = translation(ROI_1.x, ROI_1.y) * homography.inv() * translation(ROI_2.x, ROI_2.y);
+    table_view.create(ROI_2.height, ROI_2.width, CV_8UC3);
+
+    light.create(FRM_ROWS, FRM_COLS, CV_8UC3);
+    for (int c = 0; c < FRM_COLS; c++)
+    {
+        uchar level = saturate_cast<uchar>(255 * (1 - params.gradient * c / (FRM_COLS - 1)));
+        light.col(c).setTo(Scalar::all(level));
+    }
+
+    RNG rng(seed);
+    for (int i = 0; i < NOISE_BANK_SIZE; i++)
+    {
+        Mat noise(FRM_ROWS, FRM_COLS, CV_16SC3);
+        rng.fill(noise, RNG::NORMAL, Scalar::all(0), Scalar::all(params.noise));
+        noise_bank.push_back(noise);
+    }
+}
+
+void Renderer::render(const PuckState &puck, float puck_r, Point2f mallet, float mallet_r, Mat &frame)
+{
+    table_view.setTo(params.table);
+    circle(table_view, subPixel(mallet), cvRound(mallet_r * (1 << DRAW_SHIFT)), params.mallet, FILLED, LINE_AA, DRAW_SHIFT);
+
+    // A capsule along the puck's travel during the exposure
+    Point2f smear = puck.vel * (params.exposure / 2);
+    line(table_view, subPixel(puck.pos - smear), subPixel(puck.pos + smear), params.puck, 2 * cvRound(puck_r), LINE_AA, DRAW_SHIFT);
+
+    warpPerspective(table_view, frame, corrected_to_raw, Size(FRM_COLS, FRM_ROWS),
+                    INTER_LINEAR, BORDER_CONSTANT, params.background);
+
+    multiply(frame, light, frame, params.gain / 255.0);
+    if (params.offset != 0)
+    {
+        add(frame, Scalar::all(params.offset), frame);
+    }
+    if (params.blur > 0)
+    {
+        GaussianBlur(frame, frame, Size(params.blur, params.blur), 0);
+    }
+    if (params.noise > 0)
+    {
+        add(frame, noise_bank[noise_next], frame, noArray(), CV_8U);
+        noise_next = (noise_next + 1) % noise_bank.size();
+    }
+}
@@ -0,0 +1,42 @@
+#ifndef RENDERER_INCLUDED
+#define RENDERER_INCLUDED
+
+#include <opencv2/opencv.hpp>
+#include <vector>
+#include <Tracker.h>
+
+struct RenderParams
+{
+    float gain = 1.0f;     // Lighting, pixel = gain * colour + offset
+    float offset = 0;
+    float gradient = 0.2f; // Fraction of brightness lost from the left to the right edge
+    float noise = 4;       // Sensor noise std dev
+    int blur = 3;          // Gaussian blur kernel size, 0 for none
+    float exposure = 0.004f; // Puck is smeared over this much of its travel [s]
+    cv::Scalar background = cv::Scalar(40, 40, 40);
+    cv::Scalar table = cv::Scalar(200, 200, 200);
+    cv::Scalar puck = cv::Scalar(20, 20, 110); // Inside PUCK_LOWERB..PUCK_UPPERB
+    cv::Scalar mallet = cv::Scalar(30, 90, 30);
+};
+
+/* Draws the simulated table in corrected coordinates and maps it back into
+   a FRM_COLS x FRM_ROWS camera frame through the inverse of the perspective
+   correction, so the frame can go through findPuck() unchanged. */
+class Renderer
+{
+public:
+    Renderer(const cv::Mat &homography, const RenderParams &params, uint64_t seed);
+
+    void render(const PuckState &puck, float puck_r, cv::Point2f mallet, float mallet_r, cv::Mat &frame);
+
+    RenderParams params;
+
+private:
+    cv::Mat corrected_to_raw; // 3 x 3, corrected ROI_2 pixels to raw frame pixels
+    cv::Mat table_view;       // Corrected table, ROI_2 sized
+    cv::Mat light;            // Per pixel lighting gain, 255 is params.gain
+    std::vector<cv::Mat> noise_bank;
+    size_t noise_next = 0;
+};
+
+#endif
@@ -0,0 +1,167 @@
+#include <TableSim.h>
+#include <Table.h>
+#include <Strategy.h>
+
+#include <math.h>
+#include <random>
+
+using namespace cv;
+
+// Mallet centre y when the gantry is at y = 0
+#define MALLET_Y0(p) (Y_MAX - (p).mallet_r)
+
+Shot randomShot(uint64_t seed)
+{
+    std::mt19937_64 rng(seed);
+    std::uniform_real_distribution<float> start_x(X_MIN + 5, X_MAX - 5);
+    std::uniform_real_distribution<float> start_y(Y_MIN + 10, Y_MIN + 50);
+    // Aim along the table unfolded about both walls so banked shots are included
+    std::uniform_real_distribution<float> aim_x(2 * X_MIN - X_MAX, 2 * X_MAX - X_MIN);
+    std::uniform_real_distribution<float> speed(100, 500);
+
+    Shot shot;
+    shot.start.pos = Point2f(start_x(rng), start_y(rng));
+    Point2f dir = Point2f(aim_x(rng), Y_MAX) - shot.start.pos;
+    shot.start.vel = dir * (speed(rng) / sqrtf(dir.x * dir.x + dir.y * dir.y));
+    shot.seed = rng();
+    return shot;
+}
+
+TableSim::TableSim(const SimParams &p, const Shot &shot, int difficulty)
+    : p(p), difficulty(difficulty), puck(shot.start)
+{
+    // Gantry starts at home, same kinematics as the PSoC firmware
+    float gx = PUCK_HOME, gy = 0;
+    m1 = m1_target = -(gx - gy) * p.steps_per_pixel;
+    m2 = m2_target = -(gx + gy) * p.steps_per_pixel;
+    mallet = Point2f(gx, MALLET_Y0(p) - gy);
+
+    // Tracker history primed with the first sighting
+    x_0 = x_1 = puck.pos.x;
+    y_0 = y_1 = puck.pos.y;
+}
+
+void TableSim::frame(bool seen, Point2f measured)
+{
+    int8_t coord[2] = {PUCK_HOME, 0};
+
+    if (seen && difficulty >= 0)
+    {
+        float x_2 = measured.x, y_2 = measured.y;
+        float t_delta = 2 * p.frame_dt;
+        PuckState puck_seen = {Point2f(x_2, y_2), Point2f((x_2 - x_0) / t_delta, (y_2 - y_0) / t_delta)};
+        PuckState ahead = forwardPredict(puck_seen, p.latency);
+        x_0 = x_1, y_0 = y_1;
+        x_1 = x_2, y_1 = y_2;
+
+        if (!strategyCommand(strategy, difficulty, ahead, interceptX(ahead, Y_MAX), coord))
+        {
+            coord[0] = PUCK_HOME;
+            coord[1] = 0;
+        }
+    }
+
+    if (pending_count < MAX_PENDING)
+    {
+        pending[(pending_head + pending_count++) % MAX_PENDING] = {t + p.latency, (float)coord[0], (float)coord[1]};
+    }
+}
+
+// Moves one motor toward its target by at most max_steps
+static float stepToward(float m, float target, float max_steps)
+{
+    float d = target - m;
+    return m + (d > max_steps ? max_steps : d < -max_steps ? -max_steps : d);
+}
+
+bool TableSim::step()
+{
+    t += p.dt;
+    if (t >= p.max_time)
+    {
+        return false;
+    }
+
+    /*********** GANTRY ***********/
+    float spp = p.steps_per_pixel;
+    while (pending_count > 0 && pending[pending_head].t <= t)
+    {
+        Command &c = pending[pending_head];
+        m1_target = -(c.x - c.y) * spp;
+        m2_target = -(c.x + c.y) * spp;
+        pending_head = (pending_head + 1) % MAX_PENDING;
+        pending_count--;
+    }
+    // Both motors step every Timer_1 period until each reaches its target
+    m1 = stepToward(m1, m1_target, p.step_rate * p.dt);
+    m2 = stepToward(m2, m2_target, p.step_rate * p.dt);
+    Point2f mallet_next(-(m1 + m2) / (2 * spp), MALLET_Y0(p) - (m1 - m2) / (2 * spp));
+    Point2f mallet_vel = (mallet_next - mallet) * (1 / p.dt);
+    mallet = mallet_next;
+
+    /*********** PUCK ***********/
+    float speed = sqrtf(puck.vel.x * puck.vel.x + puck.vel.y * puck.vel.y);
+    if (speed < 5)
+    {
+        return false; // Stopped short
+    }
+    puck.vel *= fmaxf(0, 1 - p.friction * p.dt / speed);
+
+    // Side walls, same reflection as the tracker's forward prediction
+    puck = forwardPredict(puck, p.dt);
+
+    if (puck.pos.y < Y_MIN)
+    {
+        return false; // Cleared back up the table
+    }
+    if (puck.pos.y >= Y_MAX)
+    {
+        if (puck.pos.x >= GOAL_MIN_X && puck.pos.x <= GOAL_MAX_X)
+        {
+            scored = 1;
+            return false;
+        }
+        puck.pos.y = Y_MAX - WALL_RESTITUTION * (puck.pos.y - Y_MAX);
+        puck.vel.y = -WALL_RESTITUTION * puck.vel.y;
+    }
+
+    if (difficulty >= 0)
+    {
+        Point2f n = puck.pos - mallet;
+        float dist = sqrtf(n.x * n.x + n.y * n.y);
+        float contact = p.puck_r + p.mallet_r;
+        if (dist < contact && dist > 0)
+        {
+            n *= 1 / dist;
+            Point2f v_rel = puck.vel - mallet_vel;
+            float v_n = v_rel.x * n.x + v_rel.y * n.y;
+            if (v_n < 0)
+            {
+                // Mallet is effectively infinite mass
+                puck.vel -= n * ((1 + p.mallet_restitution) * v_n);
+            }
+            puck.pos = mallet + n * contact;
+        }
+    }
+    return true;
+}
+
+bool simulateShot(const SimParams &p, const Shot &shot, int difficulty)
+{
+    std::mt19937 rng(shot.seed);
+    std::normal_distribution<float> noise(0, p.pos_noise);
+
+    TableSim sim(p, shot, difficulty);
+    float next_frame = 0;
+    do
+    {
+        if (difficulty >= 0 && sim.t >= next_frame)
+        {
+            next_frame += p.frame_dt;
+            bool seen = sim.puck.pos.y >= Y_MIN && sim.puck.pos.y <= p.view_y_max;
+            sim.frame(seen, sim.puck.pos + Point2f(noise(rng), noise(rng)));
+        }
+    } while (sim.step());
+
+    return sim.scored;
+}
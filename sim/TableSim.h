@@ -0,0 +1,76 @@
+#ifndef TABLESIM_INCLUDED
+#define TABLESIM_INCLUDED
+
+#include <stdint.h>
+#include <Tracker.h>
+#include <Strategy.h>
+
+/* Deterministic model of the puck, the table and the gantry, in the same
+   corrected camera pixels main.cpp works in. Everything random about a
+   shot comes from its seed, so results do not depend on thread count. */
+struct SimParams
+{
+    float dt = 0.001f;          // Physics step [s]
+    float frame_dt = 1.0f / 90; // Camera frame period [s]
+    float latency = 0.022f;     // Frame to motor response [s], see latency.cfg
+    float view_y_max = 180;     // Camera cannot see the puck past this y
+    float pos_noise = 0.3f;     // Std dev of the measured puck centre [px]
+    float friction = 20;        // Air table drag as a constant deceleration [px/s^2]
+    float puck_r = 7, mallet_r = 9;
+    float mallet_restitution = 0.6f;
+    float step_rate = 1176;     // pulse_ready_isr rate, BUS_CLK / Timer_1 period [steps/s]
+    float steps_per_pixel = 8;
+    float max_time = 2;         // Shot is over after this long [s]
+};
+
+struct Shot
+{
+    PuckState start;
+    uint64_t seed; // Measurement noise
+};
+
+#define MAX_PENDING 16 // Commands in flight between camera and motors
+
+/* One shot being played out. frame() stands in for main.cpp receiving a
+   camera frame, step() for the table and gantry moving on by dt. */
+class TableSim
+{
+public:
+    TableSim(const SimParams &p, const Shot &shot, int difficulty);
+
+    // Runs the tracker and strategy on a measured puck centre, seen is false
+    // when no puck was detected. The command reaches the motors after p.latency.
+    void frame(bool seen, cv::Point2f measured);
+
+    // Advances the puck and the gantry by p.dt, returns false once the shot is over
+    bool step();
+
+    const SimParams &p;
+    int difficulty;
+    float t = 0;
+    PuckState puck;
+    cv::Point2f mallet;
+    bool scored = 0;
+
+private:
+    struct Command
+    {
+        float t; // When the motors start acting on it [s]
+        float x, y;
+    };
+    Command pending[MAX_PENDING];
+    int pending_head = 0, pending_count = 0;
+
+    float m1, m2, m1_target, m2_target; // Gantry in motor steps
+    float x_0, y_0, x_1, y_1;           // Tracker history as in main.cpp
+    Strategy strategy;
+};
+
+// Shot from the player's half toward the robot's end, possibly banked off a wall
+Shot randomShot(uint64_t seed);
+
+// Plays one shot out, returns true if it ends in the goal.
+// difficulty < 0 plays it against an empty table.
+bool simulateShot(const SimParams &p, const Shot &shot, int difficulty);
+
+#endif
@@ -0,0 +1,252 @@
+#include <iostream>
+using namespace std;
+
+#include <opencv2/opencv.hpp>
+using namespace cv;
+
+#include <chrono>
+#include <math.h>
+#include <stdlib.h>
+#include <vector>
+
+#include <Table.h>
+#include <Vision.h>
+#include <Latency.h>
+#include <TableSim.h>
+#include <Renderer.h>
+#include <Trace.h>
+
+/* Closes the loop from the simulator through rendered camera frames and the
+   unmodified findPuck() pipeline back to the strategy, as fast as it runs.
+   Reports pipeline time per frame, detection and localisation accuracy, and
+   the save rate. usage: render_bench [shots] [difficulty] [seed] [--gain g]
+   [--offset o] [--noise n] [--blur k] [--show] [--vel-stats]
+
+   --vel-stats renders constant speed shots instead and compares the v_y
+   main.cpp would take from the bounding box midpoint and from the moment
+   centroid of the same blob. */
+
+#define VEL_SPEEDS 3 // Constant speed shots, every speed from every start
+#define VEL_STARTS 5
+#define VEL_DRIFTS 3
+
+/* Straight shots down the table at constant speed, nothing to hit. v_y is
+   taken as main.cpp takes it, against the detection two frames back, from
+   the integer midpoint of the blob's box as it was before the centroid and
+   from puckCentroid(). Reports the variance of v_y within a shot, pooled
+   over the shots, and the RMS error against the true speed. */
+static void velocityStats(Renderer &renderer, const Mat &homography, VisionBuffers &vision, const SimParams &params,
+                          uint64_t seed)
+{
+    const float speeds[VEL_SPEEDS] = {150, 300, 600};   // v_y [px/s]
+    const float starts[VEL_STARTS] = {30, 50, 70, 90, 110}; // x [px]
+    const float drifts[VEL_DRIFTS] = {-15, 0, 15};      // v_x [px/s]
+    const char *names[2] = {"box midpoint", "centroid"};
+    const PuckGate gate;
+    RNG rng(seed);
+
+    double var_sum[2] = {0, 0}, err_sq_sum[2] = {0, 0};
+    long var_n[2] = {0, 0}, err_n[2] = {0, 0}, shots = 0;
+    for (float speed : speeds)
+    {
+        for (float x : starts)
+        {
+            for (float drift : drifts)
+            {
+                // Random sub-pixel start so the shots sample every phase of the pixel grid
+                PuckState puck = {Point2f(x + rng.uniform(0.f, 1.f), Y_MIN + params.puck_r + rng.uniform(0.f, 1.f)),
+                                  Point2f(drift, speed)};
+                Point2f mallet(X_MAX, Y_MAX); // Out of the way in a corner
+
+                vector<float> y[2], v[2];
+                while (puck.pos.y < Y_MAX - 2 * params.mallet_r)
+                {
+                    renderer.render(puck, params.puck_r, mallet, params.mallet_r, vision.frame);
+                    Point2f centroid;
+                    bool found = findPuck(vision, homography, centroid, gate);
+                    for (int i = 0; found && i < vision.blob_count; i++)
+                    {
+                        const Rect &r = vision.blobs[i].box;
+                        if (puckSized(vision.blobs[i], gate))
+                        {
+                            y[0].push_back(r.y + r.height / 2);
+                            y[1].push_back(centroid.y);
+                            break;
+                        }
+                    }
+                    if (!found)
+                    {
+                        y[0].clear(), y[1].clear(); // Velocity only from consecutive frames
+                    }
+                    for (int m = 0; m < 2; m++)
+                    {
+                        size_t n = y[m].size();
+                        if (n >= 3)
+                        {
+                            v[m].push_back((y[m][n - 1] - y[m][n - 3]) / (2 * params.frame_dt));
+                        }
+                    }
+                    puck.pos += puck.vel * params.frame_dt;
+                }
+
+                for (int m = 0; m < 2; m++)
+                {
+                    if (v[m].size() < 2)
+                    {
+                        continue;
+                    }
+                    double mean = 0;
+                    for (float s : v[m])
+                    {
+                        mean += s / v[m].size();
+                    }
+                    for (float s : v[m])
+                    {
+                        var_sum[m] += (s - mean) * (s - mean);
+                        err_sq_sum[m] += (s - speed) * (s - speed);
+                    }
+                    var_n[m] += v[m].size() - 1;
+                    err_n[m] += v[m].size();
+                }
+                shots++;
+            }
+        }
+    }
+
+    printf("v_y over %ld constant speed shots (%.0f to %.0f px/s)\n", shots, speeds[0], speeds[VEL_SPEEDS - 1]);
+    for (int m = 0; m < 2; m++)
+    {
+        printf("  %-13s variance %8.1f (px/s)^2\tRMS error %6.1f px/s\t%ld samples\n", names[m],
+               var_n[m] ? var_sum[m] / var_n[m] : 0.0, err_n[m] ? sqrt(err_sq_sum[m] / err_n[m]) : 0.0, err_n[m]);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    long shots = 200;
+    int difficulty = 1;
+    uint64_t seed = 1;
+    bool show = 0, vel_stats = 0;
+    RenderParams render_params;
+
+    int positional = 0;
+    for (int i = 1; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "--gain") && i + 1 < argc)
+            render_params.gain = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--offset") && i + 1 < argc)
+            render_params.offset = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--noise") && i + 1 < argc)
+            render_params.noise = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--blur") && i + 1 < argc)
+            render_params.blur = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--show"))
+            show = 1;
+        else if (!strcmp(argv[i], "--vel-stats"))
+            vel_stats = 1;
+        else if (positional == 0)
+            shots = atol(argv[i]), positional++;
+        else if (positional == 1)
+            difficulty = atoi(argv[i]), positional++;
+        else if (positional == 2)
+            seed = strtoull(argv[i], NULL, 10), positional++;
+    }
+
+    SimParams params;
+    params.pos_noise = 0; // Noise comes from the rendered frame instead
+    LatencyModel latency_model;
+    if (loadLatencyModel(LATENCY_CFG, latency_model))
+    {
+        params.latency = totalLatency(latency_model);
+    }
+
+    Mat homography_matrix = tableHomography();
+    Renderer renderer(homography_matrix, render_params, seed);
+
+    VisionBuffers vision;
+    allocVisionBuffers(vision);
+    Mat &frame = vision.frame; // Rendered straight into the pipeline's input
+
+    if (vel_stats)
+    {
+        velocityStats(renderer, homography_matrix, vision, params, seed);
+        return 0;
+    }
+
+    long frames = 0, in_view = 0, detected = 0, false_detections = 0;
+    long on_target = 0, saved = 0;
+    double pipeline_s = 0, pipeline_max_s = 0, err_sum = 0, err_sq_sum = 0, err_max = 0;
+
+    auto t_start = chrono::steady_clock::now();
+    for (long i = 0; i < shots; i++)
+    {
+        Shot shot = randomShot(seed * 1000003 + i);
+        bool counts = simulateShot(params, shot, -1); // Only score shots on target
+
+        TableSim sim(params, shot, difficulty);
+        float next_frame = 0;
+        do
+        {
+            if (sim.t < next_frame)
+            {
+                continue;
+            }
+            next_frame += params.frame_dt;
+
+            renderer.render(sim.puck, params.puck_r, sim.mallet, params.mallet_r, frame);
+            bool visible = sim.puck.pos.y >= Y_MIN && sim.puck.pos.y <= Y_MAX; // On the rendered table
+
+            auto t_0 = chrono::steady_clock::now();
+            Point2f puck_center;
+            bool found = findPuck(vision, homography_matrix, puck_center);
+            sim.frame(found, puck_center);
+            chrono::duration<double> t = chrono::steady_clock::now() - t_0;
+
+            pipeline_s += t.count();
+            pipeline_max_s = max(pipeline_max_s, t.count());
+            frames++;
+            in_view += visible;
+
+            if (found)
+            {
+                Point2f d = puck_center - sim.puck.pos;
+                double err = sqrt(d.x * d.x + d.y * d.y);
+                if (!visible || err > params.puck_r)
+                {
+                    false_detections++;
+                }
+                else
+                {
+                    detected++;
+                    err_sum += err;
+                    err_sq_sum += err * err;
+                    err_max = max(err_max, err);
+                }
+            }
+
+            if (show)
+            {
+                imshow("FRAME", frame);
+                waitKey(1);
+            }
+        } while (sim.step());
+
+        on_target += counts;
+        saved += counts && !sim.scored;
+    }
+    chrono::duration<double> t_total = chrono::steady_clock::now() - t_start;
+
+    printf("Frames: %ld (%.0f FPS including rendering)\n", frames, frames / t_total.count());
+    printf("Pipeline: mean %.3f ms\tmax %.3f ms\n", 1000 * pipeline_s / frames, 1000 * pipeline_max_s);
+    printf("Detected: %ld of %ld in view (%.1f%%)\tFalse: %ld\n",
+           detected, in_view, in_view ? 100.0 * detected / in_view : 0.0, false_detections);
+    if (detected > 0)
+    {
+        printf("Centre error: mean %.3f px\tRMS %.3f px\tmax %.3f px\n",
+               err_sum / detected, sqrt(err_sq_sum / detected), err_max);
+    }
+    printf("Saved: %ld of %ld shots on goal (%.1f%%)\n", saved, on_target,
+           on_target ? 100.0 * saved / on_target : 0.0);
+    tracePrintHistograms(false); // findPuck() by stage
+    return 0;
+}
@@ -0,0 +1,91 @@
+#include <iostream>
+using namespace std;
+
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <stdlib.h>
+
+#include <Strategy.h>
+#include <Latency.h>
+#include <TableSim.h>
+
+/* Plays random shots against every difficulty of the strategy in main.cpp
+   and reports the save rate. Shots that would miss an empty goal are not
+   counted. usage: table_sim [shots] [threads] [seed] */
+
+struct Tally
+{
+    long on_target = 0;
+    long saved[NUM_DIFFICULTIES] = {0};
+};
+
+int main(int argc, char **argv)
+{
+    long shots = argc > 1 ? atol(argv[1]) : 100000;
+    int threads = argc > 2 ? atoi(argv[2]) : thread::hardware_concurrency();
+    uint64_t seed = argc > 3 ? strtoull(argv[3], NULL, 10) : 1;
+    if (threads < 1)
+    {
+        threads = 1;
+    }
+
+    SimParams params;
+    LatencyModel latency_model;
+    if (loadLatencyModel(LATENCY_CFG, latency_model))
+    {
+        params.latency = totalLatency(latency_model);
+    }
+    printf("Shots: %ld\tThreads: %d\tSeed: %llu\tLatency: %.1f ms\n",
+           shots, threads, (unsigned long long)seed, 1000 * params.latency);
+
+    auto t_0 = chrono::steady_clock::now();
+
+    vector<Tally> tallies(threads);
+    vector<thread> workers;
+    for (int w = 0; w < threads; w++)
+    {
+        workers.emplace_back([&, w] {
+            Tally &tally = tallies[w];
+            for (long i = w; i < shots; i += threads)
+            {
+                Shot shot = randomShot(seed * 1000003 + i);
+                if (!simulateShot(params, shot, -1))
+                {
+                    continue; // Would have missed anyway
+                }
+                tally.on_target++;
+                for (int d = 0; d < NUM_DIFFICULTIES; d++)
+                {
+                    tally.saved[d] += !simulateShot(params, shot, d);
+                }
+            }
+        });
+    }
+    for (thread &worker : workers)
+    {
+        worker.join();
+    }
+
+    chrono::duration<float> t = chrono::steady_clock::now() - t_0;
+
+    Tally total;
+    for (Tally &tally : tallies)
+    {
+        total.on_target += tally.on_target;
+        for (int d = 0; d < NUM_DIFFICULTIES; d++)
+        {
+            total.saved[d] += tally.saved[d];
+        }
+    }
+
+    const char *names[NUM_DIFFICULTIES] = {"Easy", "Medium", "Hard"};
+    printf("\nShots on goal: %ld\n", total.on_target);
+    for (int d = 0; d < NUM_DIFFICULTIES; d++)
+    {
+        printf("%-8s saved %6ld\t(%.1f%%)\n", names[d], total.saved[d],
+               total.on_target ? 100.0 * total.saved[d] / total.on_target : 0.0);
+    }
+    printf("\n%.2f s, %.0f shots/s\n", t.count(), shots / t.count());
+    return 0;
+}
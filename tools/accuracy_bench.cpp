@@ -0,0 +1,200 @@
+#include <iostream>
+using namespace std;
+
+#include <opencv2/opencv.hpp>
+using namespace cv;
+
+#include <algorithm>
+#include <chrono>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+
+#include <Vision.h>
+#include <Recorder.h>
+#include <Annotations.h>
+
+/* Scores the detector against frames annotated with tools/annotate. Each
+   annotated frame goes through findPuck() with the gate given, which
+   defaults to the one main.cpp uses, and the result is checked against the
+   true centre:
+     hit             puck found within --tol of the true centre
+     miss            puck in view but not found, or found too far off
+     false positive  found with no puck in view, or too far off
+   It also reports the size of the blob under each true centre against the
+   gate, to show how much margin the gate has.
+
+   Run it before and after a change to the vision path; --min-recall,
+   --max-fp and --max-error make it exit 1 on a regression.
+
+   usage: accuracy_bench log.bhr [--truth file] [--tol px]
+          [--gate min_w max_w min_h max_h min_peri max_peri]
+          [--min-recall r] [--max-fp n] [--max-error px]
+*/
+
+struct Extent
+{
+    float lo = INFINITY, hi = -INFINITY;
+    void add(float v)
+    {
+        lo = min(lo, v);
+        hi = max(hi, v);
+    }
+};
+
+int main(int argc, char **argv)
+{
+    const char *path = NULL;
+    string truth_path;
+    float tol = 3;
+    PuckGate gate;
+    double min_recall = 0, max_error = INFINITY;
+    long max_fp = -1;
+    for (int i = 1; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "--truth") && i + 1 < argc)
+            truth_path = argv[++i];
+        else if (!strcmp(argv[i], "--tol") && i + 1 < argc)
+            tol = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--gate") && i + 6 < argc)
+        {
+            gate.min_width = atoi(argv[++i]), gate.max_width = atoi(argv[++i]);
+            gate.min_height = atoi(argv[++i]), gate.max_height = atoi(argv[++i]);
+            gate.min_perimeter = atof(argv[++i]), gate.max_perimeter = atof(argv[++i]);
+        }
+        else if (!strcmp(argv[i], "--min-recall") && i + 1 < argc)
+            min_recall = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--max-fp") && i + 1 < argc)
+            max_fp = atol(argv[++i]);
+        else if (!strcmp(argv[i], "--max-error") && i + 1 < argc)
+            max_error = atof(argv[++i]);
+        else
+            path = argv[i];
+    }
+    if (path == NULL)
+    {
+        fprintf(stderr, "usage: accuracy_bench log.bhr [--truth file] [--tol px] "
+                        "[--gate min_w max_w min_h max_h min_peri max_peri] "
+                        "[--min-recall r] [--max-fp n] [--max-error px]\n");
+        return 1;
+    }
+    if (truth_path.empty())
+    {
+        truth_path = string(path) + ANNOTATIONS_EXT;
+    }
+
+    Recording log;
+    if (!openRecording(path, log))
+    {
+        fprintf(stderr, "%s is not a session log\n", path);
+        return 1;
+    }
+    vector<Annotation> truth;
+    if (!loadAnnotations(truth_path.c_str(), truth) || truth.empty())
+    {
+        fprintf(stderr, "No annotations in %s, make some with annotate\n", truth_path.c_str());
+        return 1;
+    }
+
+    Mat homography_matrix = tableHomography();
+    VisionBuffers vision;
+    allocVisionBuffers(vision);
+
+    long frames = 0, pucks = 0, hits = 0, misses = 0, false_positives = 0, unreadable = 0;
+    vector<float> errors;
+    Extent width, height, perimeter; // Of the blob under each true centre
+    long no_blob = 0;
+    double pipeline_s = 0;
+    for (const Annotation &a : truth)
+    {
+        if (a.record < 0 || a.record >= (long)log.offsets.size() || !recordFrameImage(log, a.record, vision.frame))
+        {
+            unreadable++;
+            continue;
+        }
+        auto t_0 = chrono::steady_clock::now();
+        Point2f centre;
+        bool found = findPuck(vision, homography_matrix, centre, gate);
+        pipeline_s += chrono::duration<double>(chrono::steady_clock::now() - t_0).count();
+        frames++;
+
+        if (!a.puck)
+        {
+            false_positives += found;
+            continue;
+        }
+        pucks++;
+
+        float err = found ? hypotf(centre.x - a.centre.x, centre.y - a.centre.y) : INFINITY;
+        if (err <= tol)
+        {
+            hits++;
+            errors.push_back(err);
+        }
+        else
+        {
+            misses++;
+            false_positives += found; // Something else taken for the puck
+        }
+
+        bool under = false;
+        for (int i = 0; i < vision.blob_count && !under; i++)
+        {
+            const Blob &b = vision.blobs[i];
+            // Pixel edges, half a pixel out from the centres
+            if (a.centre.x >= b.box.x - 0.5f && a.centre.x < b.box.x + b.box.width - 0.5f &&
+                a.centre.y >= b.box.y - 0.5f && a.centre.y < b.box.y + b.box.height - 0.5f)
+            {
+                width.add(b.box.width), height.add(b.box.height), perimeter.add(b.perimeter);
+                under = true;
+            }
+        }
+        no_blob += !under;
+    }
+
+    printf("%s: %ld frames annotated, %ld with the puck in view", truth_path.c_str(), frames, pucks);
+    if (unreadable > 0)
+        printf(", %ld not in the log", unreadable);
+    printf("\nGate: width %d-%d height %d-%d perimeter %.0f-%.0f, tolerance %.1f px\n",
+           gate.min_width, gate.max_width, gate.min_height, gate.max_height,
+           gate.min_perimeter, gate.max_perimeter, tol);
+
+    double recall = pucks ? (double)hits / pucks : 0;
+    printf("Recall: %ld of %ld (%.1f%%)\tMissed: %ld\tFalse positives: %ld (%.2f%% of frames)\n",
+           hits, pucks, 100 * recall, misses, false_positives, frames ? 100.0 * false_positives / frames : 0.0);
+
+    double mean = 0, rms = 0, worst = 0, p95 = 0;
+    if (!errors.empty())
+    {
+        for (float e : errors)
+        {
+            mean += e;
+            rms += e * e;
+        }
+        mean /= errors.size();
+        rms = sqrt(rms / errors.size());
+        sort(errors.begin(), errors.end());
+        worst = errors.back();
+        p95 = errors[errors.size() * 95 / 100];
+        printf("Centre error: mean %.3f px\tRMS %.3f px\tp95 %.3f px\tmax %.3f px\n", mean, rms, p95, worst);
+    }
+    if (pucks > no_blob)
+    {
+        printf("True puck blobs: width %.0f-%.0f height %.0f-%.0f perimeter %.1f-%.1f",
+               width.lo, width.hi, height.lo, height.hi, perimeter.lo, perimeter.hi);
+        printf(no_blob ? ", %ld pucks with no blob under them\n" : "\n", no_blob);
+    }
+    if (frames > 0)
+    {
+        printf("Pipeline: mean %.3f ms\n", 1000 * pipeline_s / frames);
+    }
+    closeRecording(log);
+
+    bool regressed = recall < min_recall || (max_fp >= 0 && false_positives > max_fp) || mean > max_error;
+    if (regressed)
+    {
+        printf("Below the required accuracy\n");
+    }
+    return regressed;
+}
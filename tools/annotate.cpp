@@ -0,0 +1,185 @@
+#include <iostream>
+using namespace std;
+
+#include <opencv2/opencv.hpp>
+using namespace cv;
+
+#include <map>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+
+#include <Vision.h>
+#include <Recorder.h>
+#include <Annotations.h>
+
+/* Marks true puck centres on frames from a session log, for accuracy_bench.
+   Each frame is shown perspective corrected and zoomed, with the detector's
+   centre in red and any earlier annotation in green.
+
+     click   the puck centre is here
+     space   the detector's centre is right (only if it found one)
+     n       no puck in view
+     b       back a frame
+     Esc, q  save and quit
+
+   Annotations go to log.bhr.truth. An existing file is loaded first, so
+   annotating can stop and carry on later.
+
+   usage: annotate log.bhr [--step k] [--from i]
+   --step k shows every k-th frame, consecutive frames are much alike.
+*/
+
+#define ZOOM 4 // Screen pixels per table pixel
+
+struct Click
+{
+    bool clicked = false;
+    Point2f at;
+};
+
+static void onMouse(int event, int x, int y, int, void *data)
+{
+    Click *click = (Click *)data;
+    if (event == EVENT_LBUTTONDOWN)
+    {
+        // Centre of the zoomed pixel clicked on, in table pixels
+        click->at = Point2f((x + 0.5f) / ZOOM - 0.5f, (y + 0.5f) / ZOOM - 0.5f);
+        click->clicked = true;
+    }
+}
+
+static void cross(Mat &view, Point2f p, Scalar colour)
+{
+    Point c(cvRound((p.x + 0.5f) * ZOOM), cvRound((p.y + 0.5f) * ZOOM));
+    line(view, c - Point(2 * ZOOM, 0), c + Point(2 * ZOOM, 0), colour, 1, LINE_AA);
+    line(view, c - Point(0, 2 * ZOOM), c + Point(0, 2 * ZOOM), colour, 1, LINE_AA);
+}
+
+int main(int argc, char **argv)
+{
+    const char *path = NULL;
+    long step = 1, from = 0;
+    for (int i = 1; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "--step") && i + 1 < argc)
+            step = atol(argv[++i]);
+        else if (!strcmp(argv[i], "--from") && i + 1 < argc)
+            from = atol(argv[++i]);
+        else
+            path = argv[i];
+    }
+    if (path == NULL || step < 1)
+    {
+        fprintf(stderr, "usage: annotate log.bhr [--step k] [--from i]\n");
+        return 1;
+    }
+
+    Recording log;
+    if (!openRecording(path, log))
+    {
+        fprintf(stderr, "%s is not a session log\n", path);
+        return 1;
+    }
+    string truth_path = string(path) + ANNOTATIONS_EXT;
+    vector<Annotation> loaded;
+    loadAnnotations(truth_path.c_str(), loaded);
+    map<long, Annotation> truth; // By record, so a frame annotated again is replaced
+    for (const Annotation &a : loaded)
+    {
+        truth[a.record] = a;
+    }
+    printf("%s: %zu records, %zu annotated\n", path, log.offsets.size(), truth.size());
+
+    Mat homography_matrix = tableHomography();
+    VisionBuffers vision;
+    allocVisionBuffers(vision);
+
+    Click click;
+    namedWindow("ANNOTATE", WINDOW_NORMAL);
+    setMouseCallback("ANNOTATE", onMouse, &click);
+
+    vector<long> shown; // For going back
+    long i = from;
+    bool quit = false;
+    while (!quit && i >= 0 && i < (long)log.offsets.size())
+    {
+        if (!recordFrameImage(log, i, vision.frame))
+        {
+            i += step;
+            continue;
+        }
+        Point2f detected;
+        bool found = findPuck(vision, homography_matrix, detected);
+
+        Mat view;
+        resize(vision.table, view, Size(), ZOOM, ZOOM, INTER_NEAREST);
+        if (found)
+            cross(view, detected, Scalar(0, 0, 255));
+        auto it = truth.find(i);
+        if (it != truth.end() && it->second.puck)
+            cross(view, it->second.centre, Scalar(0, 255, 0));
+        string status = "record " + to_string(i) + (it == truth.end() ? "" : it->second.puck ? " puck" : " none");
+        putText(view, status, Point(5, 15), FONT_HERSHEY_SIMPLEX, 0.4, Scalar(255, 255, 255));
+        imshow("ANNOTATE", view);
+
+        Annotation a;
+        a.record = i;
+        a.puck = true;
+        bool next = false, back = false;
+        click.clicked = false;
+        while (!next && !back && !quit)
+        {
+            int key = waitKey(20);
+            if (click.clicked)
+            {
+                a.centre = click.at;
+                next = true;
+            }
+            else if (key == ' ' && found)
+            {
+                a.centre = detected;
+                next = true;
+            }
+            else if (key == 'n')
+            {
+                a.puck = false;
+                next = true;
+            }
+            else if (key == 'b')
+            {
+                back = true;
+            }
+            else if (key == 27 || key == 'q')
+            {
+                quit = true;
+            }
+        }
+
+        if (next)
+        {
+            truth[i] = a;
+            shown.push_back(i);
+            i += step;
+        }
+        else if (back && !shown.empty())
+        {
+            i = shown.back();
+            shown.pop_back();
+        }
+    }
+
+    vector<Annotation> annotations;
+    for (const auto &entry : truth)
+    {
+        annotations.push_back(entry.second);
+    }
+    if (!saveAnnotations(truth_path.c_str(), annotations))
+    {
+        fprintf(stderr, "Unable to write %s\n", truth_path.c_str());
+        return 1;
+    }
+    printf("%zu annotations in %s\n", annotations.size(), truth_path.c_str());
+    closeRecording(log);
+    return 0;
+}
@@ -0,0 +1,130 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sched.h>
+#include <algorithm>
+#include <vector>
+
+#include <RTLib.h>
+
+/* Wake-up latency of a SCHED_FIFO thread, the way cyclictest measures it:
+   sleep to an absolute time every interval and record how late the thread
+   runs. Run once with the thread free to go on any core and once pinned to
+   an isolated one, to see what isolcpus= buys the vision loop. Put the Pi
+   under its usual load (main.cpp's camera, or stress-ng) while it runs.
+
+   usage: jitter_bench [seconds per run] [--interval us] [--irqs]
+   --irqs moves the camera and UART IRQs to the isolated core first, as main.cpp does.
+*/
+
+#define DEFAULT_SECONDS 10
+#define DEFAULT_INTERVAL_US 1000
+
+struct JitterResult
+{
+    int cpu;
+    std::vector<long> late_ns; // One per wake-up, sorted once the run is done
+};
+
+static void measure(JitterResult &result, long interval_ns)
+{
+    struct timespec next;
+    clock_gettime(CLOCK_MONOTONIC, &next);
+    for (size_t i = 0; i < result.late_ns.size(); i++)
+    {
+        next.tv_nsec += interval_ns;
+        while (next.tv_nsec >= 1000000000)
+        {
+            next.tv_nsec -= 1000000000;
+            next.tv_sec++;
+        }
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        result.late_ns[i] = (now.tv_sec - next.tv_sec) * 1000000000L + (now.tv_nsec - next.tv_nsec);
+    }
+    result.cpu = sched_getcpu();
+    std::sort(result.late_ns.begin(), result.late_ns.end());
+}
+
+static bool run(const char *placement, int cpu, long samples, long interval_ns)
+{
+    JitterResult result;
+    result.late_ns.resize(samples); // Before the thread starts, so it never allocates
+
+    RtThreadConfig config;
+    config.name = "jitter";
+    config.priority = sched_get_priority_max(SCHED_FIFO);
+    config.cpu = cpu;
+
+    pthread_t thread;
+    if (!startRtThread(thread, config, [&] { measure(result, interval_ns); }))
+    {
+        fprintf(stderr, "Unable to start the %s thread\n", placement);
+        return false;
+    }
+    pthread_join(thread, NULL);
+
+    const std::vector<long> &v = result.late_ns;
+    double sum = 0;
+    for (long ns : v)
+    {
+        sum += ns;
+    }
+    printf("%-9s %4d %8ld %9.1f %9.1f %9.1f %9.1f %9.1f\n", placement, result.cpu, samples,
+           v.front() / 1000.0, sum / samples / 1000.0, v[samples / 2] / 1000.0,
+           v[samples * 99 / 100] / 1000.0, v.back() / 1000.0);
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    int seconds = DEFAULT_SECONDS;
+    long interval_us = DEFAULT_INTERVAL_US;
+    bool irqs = false;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--interval") == 0 && i + 1 < argc)
+        {
+            interval_us = atol(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--irqs") == 0)
+        {
+            irqs = true;
+        }
+        else
+        {
+            seconds = atoi(argv[i]);
+        }
+    }
+    long samples = interval_us > 0 ? seconds * 1000000L / interval_us : 0;
+    if (seconds <= 0 || samples < 1) // An interval longer than the run leaves nothing to measure
+    {
+        fprintf(stderr, "usage: jitter_bench [seconds per run] [--interval us] [--irqs]\n");
+        return 1;
+    }
+
+    lockProcessMemory(0);
+
+    int cpu = isolatedCpu();
+    if (cpu >= 0 && irqs)
+    {
+        printf("%d camera and %d UART IRQs moved to cpu %d\n",
+               moveIrqs(RT_CAMERA_IRQS, cpu), moveIrqs(RT_UART_IRQS, cpu), cpu);
+    }
+
+    printf("%ld wake-ups every %ld us per run\n", samples, interval_us);
+    printf("%-9s %4s %8s %9s %9s %9s %9s %9s [us late]\n", "placement", "cpu", "n", "min", "mean", "p50", "p99", "max");
+    run("shared", -1, samples, interval_us * 1000);
+    if (cpu >= 0)
+    {
+        run("isolated", cpu, samples, interval_us * 1000);
+    }
+    else
+    {
+        printf("No isolated cpu, boot with isolcpus=3 nohz_full=3 (cmdline.txt) to compare\n");
+    }
+    return 0;
+}
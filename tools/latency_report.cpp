@@ -0,0 +1,208 @@
+#include <iostream>
+using namespace std;
+
+#include <opencv2/opencv.hpp>
+using namespace cv;
+
+#include <wiringPi.h>
+#include <wiringSerial.h>
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <thread>
+#include <unistd.h>
+
+#include <Table.h>
+#include <Latency.h>
+#include <Vision.h>
+
+/* Breaks down the end-to-end latency model and measures it with LEDs.
+
+   Camera path: a Pi GPIO LED in view of the camera is switched on and the
+   time until a frame shows it is taken as exposure + transfer.
+   Motor path: a coord packet is sent to the PSoC, which lights its LED
+   (Control_Reg_3) once it starts stepping. The time until a frame shows it,
+   minus the camera path and the UART time, is the step start latency.
+
+   usage: latency_report [cfg] [--pi-led pin x y w h] [--psoc-led x y w h] [--write]
+*/
+
+#define TRIALS 10
+#define LED_THRESH 40 // Brightness jump that counts as the LED turning on
+#define LED_TIMEOUT 1.0 // [s]
+
+VideoCapture cam(0);
+
+float medianOf(vector<float> v)
+{
+    sort(v.begin(), v.end());
+    return v.empty() ? 0 : v[v.size() / 2];
+}
+
+float brightness(const Mat &frame, const Rect &roi)
+{
+    Scalar m = mean(frame(roi));
+    return (m[0] + m[1] + m[2]) / 3;
+}
+
+// Seconds from trigger() until a frame shows roi brighter, -1 on timeout
+float timeToLed(const Rect &roi, function<void()> trigger)
+{
+    Mat frame;
+    for (int i = 0; i < 10; i++)
+    {
+        cam.read(frame); // Flush stale buffered frames
+    }
+    float base = brightness(frame, roi);
+
+    auto t_0 = chrono::steady_clock::now();
+    trigger();
+    while (true)
+    {
+        cam.read(frame);
+        chrono::duration<float> t = chrono::steady_clock::now() - t_0;
+        if (brightness(frame, roi) > base + LED_THRESH)
+        {
+            return t.count();
+        }
+        if (t.count() > LED_TIMEOUT)
+        {
+            return -1;
+        }
+    }
+}
+
+void sendCoord(int fd, int x, int y)
+{
+    int8_t coord[4] = {(int8_t)x, (int8_t)y, 0, 0};
+    write(fd, &coord, 4);
+}
+
+int main(int argc, char **argv)
+{
+    const char *cfg = LATENCY_CFG;
+    int pi_led_pin = -1;
+    Rect pi_led_roi, psoc_led_roi;
+    bool measure_psoc = 0, write_cfg = 0;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "--pi-led") && i + 5 < argc)
+        {
+            pi_led_pin = atoi(argv[i + 1]);
+            pi_led_roi = Rect(atoi(argv[i + 2]), atoi(argv[i + 3]), atoi(argv[i + 4]), atoi(argv[i + 5]));
+            i += 5;
+        }
+        else if (!strcmp(argv[i], "--psoc-led") && i + 4 < argc)
+        {
+            measure_psoc = 1;
+            psoc_led_roi = Rect(atoi(argv[i + 1]), atoi(argv[i + 2]), atoi(argv[i + 3]), atoi(argv[i + 4]));
+            i += 4;
+        }
+        else if (!strcmp(argv[i], "--write"))
+        {
+            write_cfg = 1;
+        }
+        else if (argv[i][0] != '-')
+        {
+            cfg = argv[i];
+        }
+        else
+        {
+            fprintf(stderr, "usage: %s [cfg] [--pi-led pin x y w h] [--psoc-led x y w h] [--write]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    LatencyModel model;
+    if (!loadLatencyModel(cfg, model))
+    {
+        printf("No %s, starting from defaults\n", cfg);
+    }
+
+    if (pi_led_pin >= 0 || measure_psoc)
+    {
+        if (wiringPiSetup() == -1)
+        {
+            fprintf(stderr, "Unable to start wiringPi: %s\n", strerror(errno));
+            return 1;
+        }
+        cam.set(CAP_PROP_FRAME_WIDTH, FRM_COLS);
+        cam.set(CAP_PROP_FRAME_HEIGHT, FRM_ROWS);
+        cam.set(CAP_PROP_FPS, FRM_RATE);
+
+        // Frame period from back to back reads
+        Mat frame;
+        cam.read(frame);
+        auto t_0 = chrono::steady_clock::now();
+        for (int i = 0; i < FRM_RATE; i++)
+        {
+            cam.read(frame);
+        }
+        chrono::duration<float> t = chrono::steady_clock::now() - t_0;
+        float frame_ms = 1000 * t.count() / FRM_RATE;
+        printf("Frame period: %.2f ms\n", frame_ms);
+
+        // Exposure is assumed to span the frame, the puck is seen at mid-exposure
+        model.exposure_ms = frame_ms / 2;
+        model.uart_ms = 4 * 10 * 1000.0f / 115200;
+
+        if (pi_led_pin >= 0)
+        {
+            pinMode(pi_led_pin, OUTPUT);
+            vector<float> trials;
+            for (int i = 0; i < TRIALS; i++)
+            {
+                digitalWrite(pi_led_pin, LOW);
+                this_thread::sleep_for(chrono::milliseconds(200));
+                float t_led = timeToLed(pi_led_roi, [&] { digitalWrite(pi_led_pin, HIGH); });
+                if (t_led > 0)
+                    trials.push_back(1000 * t_led);
+            }
+            digitalWrite(pi_led_pin, LOW);
+            float camera_ms = medianOf(trials);
+            printf("Pi LED to frame: %.2f ms (%zu/%d trials)\n", camera_ms, trials.size(), TRIALS);
+            model.transfer_ms = max(0.0f, camera_ms - model.exposure_ms);
+        }
+
+        if (measure_psoc)
+        {
+            int fd;
+            if ((fd = serialOpen("/dev/ttyS0", 115200)) < 0)
+            {
+                fprintf(stderr, "Unable to open serial device: %s\n", strerror(errno));
+                return 1;
+            }
+
+            vector<float> trials;
+            int target = PUCK_HOME - 20;
+            sendCoord(fd, target, 0);
+            for (int i = 0; i < TRIALS; i++)
+            {
+                this_thread::sleep_for(chrono::seconds(1)); // Let the move finish so the LED is off
+                target = target < PUCK_HOME ? PUCK_HOME + 20 : PUCK_HOME - 20;
+                float t_led = timeToLed(psoc_led_roi, [&] { sendCoord(fd, target, 0); });
+                if (t_led > 0)
+                    trials.push_back(1000 * t_led);
+            }
+            serialClose(fd);
+            float motor_ms = medianOf(trials);
+            printf("Packet to PSoC LED frame: %.2f ms (%zu/%d trials)\n", motor_ms, trials.size(), TRIALS);
+            model.step_start_ms = max(0.0f, motor_ms - model.uart_ms - model.exposure_ms - model.transfer_ms);
+        }
+        printf("\n");
+    }
+
+    printLatencyModel(model);
+
+    if (write_cfg)
+    {
+        if (!saveLatencyModel(cfg, model))
+        {
+            fprintf(stderr, "Unable to write %s\n", cfg);
+            return 1;
+        }
+        printf("Written to %s\n", cfg);
+    }
+    return 0;
+}
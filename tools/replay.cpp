@@ -0,0 +1,175 @@
+#include <iostream>
+using namespace std;
+
+#include <opencv2/opencv.hpp>
+using namespace cv;
+
+#include <chrono>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <Table.h>
+#include <Vision.h>
+#include <Tracker.h>
+#include <Strategy.h>
+#include <Recorder.h>
+
+/* Runs a session log from main.cpp's recorder back through the pipeline.
+   Every record carries the loop state the frame started from, so any frame
+   runs on its own, the same way it did live: vision, velocity, prediction
+   and strategy. Reports where the result differs from what was recorded,
+   which it should not unless the pipeline has changed since.
+
+   usage: replay log.bhr [--from i] [--to j] [--show]
+   --show steps through the frames, recorded puck in green, replayed in red.
+*/
+
+#define MAX_LISTED 20 // Mismatches printed one by one
+
+struct Replayed
+{
+    bool found = false;
+    Point2f puck;
+    float x_pred = NAN;
+    bool waiting = true;
+    int8_t coord[4];
+};
+
+// Frame i as the loop in main.cpp would run it
+static Replayed replayFrame(VisionBuffers &vision, const Mat &homography, const RecordHeader &r)
+{
+    Replayed out;
+    float x_2 = r.x_1, y_2 = r.y_1; // Last detection if there is no new one
+
+    Point2f puck_center;
+    if (findPuck(vision, homography, puck_center))
+    {
+        out.found = true;
+        out.puck = puck_center;
+        x_2 = puck_center.x, y_2 = puck_center.y;
+
+        float v_x = (x_2 - r.x_0) / r.t_delta;
+        float v_y = (y_2 - r.y_0) / r.t_delta;
+        PuckState puck = forwardPredict({Point2f(x_2, y_2), Point2f(v_x, v_y)}, r.latency);
+        out.x_pred = interceptX(puck, Y_MAX);
+
+        Strategy strategy;
+        strategy.state = (StrategyState)r.strategy_state;
+        strategy.threat_frames = r.threat_frames;
+        out.waiting = !strategyCommand(strategy, r.track.difficulty, puck, out.x_pred, out.coord);
+    }
+
+    commandPacket(out.coord, out.waiting, x_2, y_2);
+    return out;
+}
+
+static bool sameFloat(float a, float b)
+{
+    return a == b || (isnan(a) && isnan(b));
+}
+
+static bool matches(const Replayed &p, const TelemetryFrame &t)
+{
+    if (p.found != (bool)t.found || p.waiting != (bool)t.waiting || memcmp(p.coord, t.coord, 4) != 0)
+    {
+        return false;
+    }
+    return !p.found || (p.puck.x == t.puck_x && p.puck.y == t.puck_y && sameFloat(p.x_pred, t.x_pred));
+}
+
+int main(int argc, char **argv)
+{
+    const char *path = NULL;
+    long from = 0, to = -1;
+    bool show = 0;
+    for (int i = 1; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "--from") && i + 1 < argc)
+            from = atol(argv[++i]);
+        else if (!strcmp(argv[i], "--to") && i + 1 < argc)
+            to = atol(argv[++i]);
+        else if (!strcmp(argv[i], "--show"))
+            show = 1;
+        else
+            path = argv[i];
+    }
+    if (path == NULL)
+    {
+        fprintf(stderr, "usage: replay log.bhr [--from i] [--to j] [--show]\n");
+        return 1;
+    }
+
+    Recording log;
+    if (!openRecording(path, log))
+    {
+        fprintf(stderr, "%s is not a session log\n", path);
+        return 1;
+    }
+    long count = log.offsets.size();
+    if (to < 0 || to > count)
+    {
+        to = count;
+    }
+    if (from < 0)
+    {
+        from = 0;
+    }
+    if (from > count)
+    {
+        from = count;
+    }
+    printf("%s: %ld records, replaying %ld to %ld\n", path, count, from, to);
+
+    Mat homography_matrix = tableHomography();
+    VisionBuffers vision;
+    allocVisionBuffers(vision);
+
+    long replayed = 0, no_image = 0, mismatches = 0;
+    double decode_s = 0, pipeline_s = 0;
+    for (long i = from; i < to; i++)
+    {
+        const RecordHeader &r = recordAt(log, i);
+        auto t_0 = chrono::steady_clock::now();
+        if (!recordFrameImage(log, i, vision.frame))
+        {
+            no_image++;
+            continue;
+        }
+        auto t_1 = chrono::steady_clock::now();
+        Replayed p = replayFrame(vision, homography_matrix, r);
+        auto t_2 = chrono::steady_clock::now();
+        decode_s += chrono::duration<double>(t_1 - t_0).count();
+        pipeline_s += chrono::duration<double>(t_2 - t_1).count();
+        replayed++;
+
+        if (!matches(p, r.track) && ++mismatches <= MAX_LISTED)
+        {
+            printf("%ld (frame %u): recorded found %d (%.2f, %.2f) x_pred %.1f cmd %d %d, "
+                   "replayed found %d (%.2f, %.2f) x_pred %.1f cmd %d %d\n",
+                   i, r.track.seq, r.track.found, r.track.puck_x, r.track.puck_y, r.track.x_pred,
+                   r.track.coord[0], r.track.coord[1],
+                   p.found, p.puck.x, p.puck.y, p.x_pred, p.coord[0], p.coord[1]);
+        }
+
+        if (show)
+        {
+            Mat view = vision.table.clone();
+            if (r.track.found)
+                circle(view, Point2f(r.track.puck_x, r.track.puck_y), 3, Scalar(0, 255, 0), 1, LINE_AA);
+            if (p.found)
+                circle(view, p.puck, 2, Scalar(0, 0, 255), -1, LINE_AA);
+            imshow("REPLAY", view);
+            if (waitKey(0) == 27)
+                break;
+        }
+    }
+
+    printf("Replayed: %ld\tNo image: %ld\tMismatches: %ld\n", replayed, no_image, mismatches);
+    if (replayed > 0)
+    {
+        printf("Decode: mean %.3f ms\tPipeline: mean %.3f ms\n", 1000 * decode_s / replayed, 1000 * pipeline_s / replayed);
+    }
+    closeRecording(log);
+    return mismatches > 0;
+}
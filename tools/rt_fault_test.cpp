@@ -0,0 +1,116 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#include <RTLib.h>
+
+/* Checks that an RT thread set up the way main.cpp sets up the vision loop
+   takes no page faults in steady state: memory locked with the same
+   RT_HEAP_RESERVE, and the thread started with startRtThread() at the top
+   SCHED_FIFO priority. The thread's body allocates and frees heap blocks of
+   mixed sizes up to HEAP_LIVE, standing in for OpenCV's worker threads, and
+   recurses most of the way down its stack, once to warm up and then for the
+   given number of rounds, and the thread's page fault count has to stay
+   where it was after the warm-up.
+
+   usage: rt_fault_test [rounds]
+
+   Exits 1 if any fault is taken after the warm-up. Run it as root (or with
+   CAP_IPC_LOCK and CAP_SYS_NICE) so mlockall() and SCHED_FIFO succeed. */
+
+#define DEFAULT_ROUNDS 100
+#define HEAP_LIVE (4 * 1024 * 1024) // Most allocated at once per round, inside RT_HEAP_RESERVE [bytes]
+#define FRAME_BYTES 4096            // Stack used per recursion level
+#define STACK_DEPTH (RT_STACK_SIZE * 3 / 4 / FRAME_BYTES)
+
+// Uses depth stack frames of FRAME_BYTES each, touching every page of them
+static int recurse(int depth)
+{
+    volatile char frame[FRAME_BYTES];
+    for (int i = 0; i < FRAME_BYTES; i += 256)
+    {
+        frame[i] = (char)depth;
+    }
+    return depth > 0 ? frame[depth % FRAME_BYTES] + recurse(depth - 1) : frame[0];
+}
+
+// Allocates blocks from 64 bytes to 1 MB up to HEAP_LIVE, writes them and frees them
+static long churnHeap(unsigned &seed)
+{
+    std::vector<char *> blocks;
+    blocks.reserve(4096);
+    size_t live = 0;
+    long sum = 0;
+    while (live < HEAP_LIVE && blocks.size() < blocks.capacity())
+    {
+        size_t size = (size_t)64 << (rand_r(&seed) % 15);
+        char *block = (char *)malloc(size);
+        if (block == NULL)
+        {
+            break;
+        }
+        memset(block, 1, size);
+        sum += block[size - 1];
+        blocks.push_back(block);
+        live += size;
+    }
+    for (char *block : blocks)
+    {
+        free(block);
+    }
+    return sum;
+}
+
+int main(int argc, char **argv)
+{
+    int rounds = argc > 1 ? atoi(argv[1]) : DEFAULT_ROUNDS;
+    if (rounds <= 0)
+    {
+        fprintf(stderr, "usage: rt_fault_test [rounds]\n");
+        return 1;
+    }
+
+    lockProcessMemory(RT_HEAP_RESERVE);
+
+    PageFaults warm_up, steady;
+    long work = 0;
+    RtThreadConfig config;
+    config.name = "fault_test";
+    config.priority = sched_get_priority_max(SCHED_FIFO);
+
+    pthread_t thread;
+    bool started = startRtThread(thread, config, [&] {
+        unsigned seed = 1;
+        PageFaults faults_0 = threadPageFaults();
+        work += churnHeap(seed) + recurse(STACK_DEPTH);
+        PageFaults faults_1 = threadPageFaults();
+        for (int i = 0; i < rounds; i++)
+        {
+            work += churnHeap(seed) + recurse(STACK_DEPTH);
+        }
+        PageFaults faults_2 = threadPageFaults();
+
+        warm_up.major = faults_1.major - faults_0.major;
+        warm_up.minor = faults_1.minor - faults_0.minor;
+        steady.major = faults_2.major - faults_1.major;
+        steady.minor = faults_2.minor - faults_1.minor;
+    });
+    if (!started)
+    {
+        fprintf(stderr, "Unable to start the test thread\n");
+        return 1;
+    }
+    pthread_join(thread, NULL);
+
+    printf("%d rounds of %d MB heap and %d kB stack (%ld)\n", rounds, HEAP_LIVE >> 20,
+           STACK_DEPTH * FRAME_BYTES / 1024, work);
+    printf("Warm-up: Pagefaults Major:%ld Minor:%ld\n", warm_up.major, warm_up.minor);
+    printf("Steady state: Pagefaults Major:%ld Minor:%ld\n", steady.major, steady.minor);
+    if (steady.major != 0 || steady.minor != 0)
+    {
+        printf("FAIL: page faults after the warm-up\n");
+        return 1;
+    }
+    return 0;
+}
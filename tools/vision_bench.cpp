@@ -0,0 +1,367 @@
+#include <iostream>
+using namespace std;
+
+#include <opencv2/opencv.hpp>
+using namespace cv;
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <tuple>
+
+#include <Table.h>
+#include <Vision.h>
+#include <Tracker.h>
+#include <Strategy.h>
+#include <Renderer.h>
+
+/* Times each stage of the pipeline on its own, google-benchmark style: a
+   stage is run in a loop, doubling the iterations until the loop takes
+   --min-time, and reported in ns per frame. Inputs are rendered 320x240
+   camera frames with the puck all over the table, so every stage sees the
+   sizes it sees live (148x221 once cropped). Stages with an alternative
+   implementation have it alongside, named stage/alternative.
+
+   Before timing anything it checks findBlobs() gives the same blobs as the
+   findContours() it replaced, and exits 1 if not.
+
+   usage: vision_bench [filter] [--min-time s] [--csv]
+   filter runs only the benchmarks whose name contains it.
+*/
+
+#define BENCH_FRAMES 16 // Distinct inputs each benchmark cycles through
+
+#define CHECK_MASKS 200 // Random masks findBlobs() is checked on, besides the fixed ones
+
+// Keeps the compiler from dropping a result nothing reads
+template <class T>
+static inline void doNotOptimize(const T &value)
+{
+    asm volatile("" : : "g"(&value) : "memory");
+}
+
+struct Benchmark
+{
+    const char *name;
+    function<void(int)> body; // Runs once on input i
+};
+
+// ns per call of body, over at least min_time seconds
+static double runBenchmark(const Benchmark &b, double min_time, long &iterations)
+{
+    b.body(0); // Warm up caches and any lazy allocation
+    for (iterations = 1;; iterations *= 2)
+    {
+        auto t_0 = chrono::steady_clock::now();
+        for (long i = 0; i < iterations; i++)
+        {
+            b.body(i % BENCH_FRAMES);
+        }
+        double t = chrono::duration<double>(chrono::steady_clock::now() - t_0).count();
+        if (t >= min_time || iterations >= (1L << 40))
+        {
+            return 1e9 * t / iterations;
+        }
+    }
+}
+
+/* findBlobs() stands in for findContours() in the detector, so it has to
+   give the same blobs: one per outer border, which is RETR_CCOMP's top
+   level (RETR_EXTERNAL's too unless a blob sits in another's hole), with
+   boundingRect() and arcLength() of that border. Compared in any order,
+   returns false and says what differs if they are not the same. */
+static bool blobsMatch(const Mat &mask, VisionBuffers &buf, const char *name)
+{
+    struct Found
+    {
+        Rect box;
+        double perimeter;
+        bool operator<(const Found &o) const
+        {
+            return make_tuple(box.y, box.x, box.height, box.width, perimeter) <
+                   make_tuple(o.box.y, o.box.x, o.box.height, o.box.width, o.perimeter);
+        }
+    };
+
+    vector<vector<Point>> contours;
+    vector<Vec4i> hierarchy;
+    findContours(mask.clone(), contours, hierarchy, RETR_CCOMP, CHAIN_APPROX_SIMPLE);
+    vector<Found> expected;
+    for (size_t i = 0; i < contours.size(); i++)
+    {
+        if (hierarchy[i][3] < 0) // Outer border, holes have a parent
+        {
+            expected.push_back({boundingRect(contours[i]), arcLength(contours[i], true)});
+        }
+    }
+    if (expected.size() > MAX_BLOBS)
+    {
+        return true; // findBlobs() stops at MAX_BLOBS in raster order, not comparable
+    }
+
+    mask.copyTo(buf.filtered);
+    findBlobs(buf);
+    vector<Found> found;
+    for (int i = 0; i < buf.blob_count; i++)
+    {
+        found.push_back({buf.blobs[i].box, buf.blobs[i].perimeter});
+    }
+
+    sort(expected.begin(), expected.end());
+    sort(found.begin(), found.end());
+    bool same = found.size() == expected.size();
+    for (size_t i = 0; same && i < found.size(); i++)
+    {
+        same = found[i].box == expected[i].box &&
+               fabs(found[i].perimeter - expected[i].perimeter) <= 1e-5 * expected[i].perimeter + 1e-4; // float sum
+    }
+    if (!same)
+    {
+        fprintf(stderr, "findBlobs differs from findContours on %s: %zu blobs, %zu contours\n", name, found.size(),
+                expected.size());
+        for (size_t i = 0; i < max(found.size(), expected.size()); i++)
+        {
+            const Found *f = i < found.size() ? &found[i] : NULL, *e = i < expected.size() ? &expected[i] : NULL;
+            fprintf(stderr, "  %3d,%3d %3dx%-3d %8.3f   %3d,%3d %3dx%-3d %8.3f\n", f ? f->box.x : -1, f ? f->box.y : -1,
+                    f ? f->box.width : 0, f ? f->box.height : 0, f ? f->perimeter : 0, e ? e->box.x : -1,
+                    e ? e->box.y : -1, e ? e->box.width : 0, e ? e->box.height : 0, e ? e->perimeter : 0);
+        }
+    }
+    return same;
+}
+
+// Checks findBlobs() on the rendered frames' masks and on drawn shapes that
+// stress the border trace: single pixels, lines, diagonals, rings, blobs in
+// holes and blobs against the image edge. Returns the number checked, or -1
+// if any differed.
+static int checkBlobs(const vector<VisionBuffers> &input)
+{
+    VisionBuffers buf;
+    allocVisionBuffers(buf);
+    const Size size(ROI_2.width, ROI_2.height);
+    int checked = 0;
+    bool ok = true;
+    auto check = [&](const Mat &mask, const char *name) {
+        ok &= blobsMatch(mask, buf, name);
+        checked++;
+    };
+
+    for (const VisionBuffers &in : input)
+    {
+        check(in.filtered, "rendered frame");
+    }
+
+    Mat m = Mat::zeros(size, CV_8UC1);
+    rectangle(m, Rect(0, 0, 1, 1), 255, FILLED);
+    rectangle(m, Rect(5, 5, 1, 10), 255, FILLED);
+    rectangle(m, Rect(10, 5, 10, 1), 255, FILLED);
+    rectangle(m, Rect(30, 30, 20, 15), 255, FILLED);
+    rectangle(m, Rect(size.width - 3, size.height - 4, 3, 4), 255, FILLED);
+    rectangle(m, Rect(0, 100, 5, 5), 255, FILLED);
+    check(m, "rectangles");
+
+    m = Scalar(0);
+    line(m, Point(5, 5), Point(100, 5), 255);
+    line(m, Point(5, 20), Point(5, 120), 255);
+    line(m, Point(20, 20), Point(90, 90), 255);
+    line(m, Point(140, 20), Point(40, 120), 255);
+    line(m, Point(10, 200), Point(140, 150), 255, 2);
+    check(m, "lines");
+
+    m = Scalar(0);
+    circle(m, Point(40, 40), 15, 255);
+    circle(m, Point(100, 60), 20, 255, 2);
+    circle(m, Point(70, 150), 25, 255, 3);
+    ellipse(m, Point(40, 190), Size(20, 10), 30, 0, 360, 255);
+    check(m, "rings");
+
+    m = Scalar(0);
+    rectangle(m, Rect(20, 20, 100, 180), 255, FILLED);
+    rectangle(m, Rect(40, 40, 60, 140), 0, FILLED);
+    circle(m, Point(70, 110), 10, 255, FILLED);
+    circle(m, Point(70, 110), 4, 0, FILLED);
+    circle(m, Point(70, 110), 1, 255, FILLED);
+    check(m, "nested");
+
+    RNG rng(1);
+    for (int i = 0; i < CHECK_MASKS; i++)
+    {
+        m = Scalar(0);
+        for (int k = rng.uniform(1, 20); k > 0; k--)
+        {
+            Point c(rng.uniform(-5, size.width + 5), rng.uniform(-5, size.height + 5));
+            int thickness = rng.uniform(0, 3) == 0 ? FILLED : rng.uniform(1, 3);
+            switch (rng.uniform(0, 3))
+            {
+            case 0:
+                circle(m, c, rng.uniform(0, 15), 255, thickness);
+                break;
+            case 1:
+                ellipse(m, c, Size(rng.uniform(1, 20), rng.uniform(1, 20)), rng.uniform(0, 180), 0, 360, 255, thickness);
+                break;
+            default:
+                line(m, c, Point(rng.uniform(0, size.width), rng.uniform(0, size.height)), 255, rng.uniform(1, 3));
+                break;
+            }
+        }
+        check(m, "random shapes");
+    }
+    return ok ? checked : -1;
+}
+
+int main(int argc, char **argv)
+{
+    const char *filter = "";
+    double min_time = 0.5;
+    bool csv = 0;
+    for (int i = 1; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "--min-time") && i + 1 < argc)
+            min_time = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--csv"))
+            csv = 1;
+        else
+            filter = argv[i];
+    }
+
+    /******************** INPUTS *********************/
+    Mat homography_matrix = tableHomography();
+    RenderParams render_params;
+    Renderer renderer(homography_matrix, render_params, 1);
+
+    // One set of buffers per input, each stage's output is the next one's input
+    vector<VisionBuffers> input(BENCH_FRAMES);
+    vector<PuckState> pucks(BENCH_FRAMES);
+    int found = 0;
+    for (int i = 0; i < BENCH_FRAMES; i++)
+    {
+        VisionBuffers &buf = input[i];
+        allocVisionBuffers(buf);
+        pucks[i].pos = Point2f(X_MIN + 15 + (X_MAX - X_MIN - 30) * (i % 4) / 3.0f, 30 + 140 * (i / 4) / 3.0f);
+        pucks[i].vel = Point2f(120 * ((i % 3) - 1), 400);
+        renderer.render(pucks[i], 7, Point2f(PUCK_HOME, Y_MAX - 10), 9, buf.frame);
+
+        Point2f centre;
+        found += findPuck(buf, homography_matrix, centre);
+    }
+    VisionBuffers out, full; // Stage outputs, and the whole pipeline's own buffers
+    allocVisionBuffers(out);
+    allocVisionBuffers(full);
+    Strategy strategy;
+
+    int checked = checkBlobs(input);
+    if (checked < 0)
+    {
+        return 1;
+    }
+
+    /******************** BENCHMARKS *********************/
+    vector<Benchmark> benchmarks = {
+        {"warp", [&](int i) {
+             out.frame = input[i].frame;
+             warpTable(out, homography_matrix);
+             doNotOptimize(out.warped.data);
+         }},
+        {"warp/nearest", [&](int i) {
+             warpPerspective(input[i].frame(ROI_1), out.warped, homography_matrix, Size(WARP_COLS, WARP_ROWS), INTER_NEAREST);
+             doNotOptimize(out.warped.data);
+         }},
+        {"threshold", [&](int i) {
+             out.table = input[i].table;
+             thresholdTable(out);
+             doNotOptimize(out.mask.data);
+         }},
+        {"median", [&](int i) {
+             out.mask = input[i].mask;
+             filterMask(out);
+             doNotOptimize(out.filtered.data);
+         }},
+        {"median/open", [&](int i) {
+             static const Mat kernel = getStructuringElement(MORPH_RECT, Size(5, 5));
+             morphologyEx(input[i].mask, out.filtered, MORPH_OPEN, kernel);
+             doNotOptimize(out.filtered.data);
+         }},
+        {"blobs", [&](int i) {
+             out.filtered = input[i].filtered;
+             findBlobs(out);
+             doNotOptimize(out.blob_count);
+         }},
+        {"blobs/findContours", [&](int i) {
+             // What findBlobs() replaced, allocates every call
+             vector<vector<Point>> contours;
+             findContours(input[i].filtered, contours, RETR_EXTERNAL, CHAIN_APPROX_SIMPLE);
+             for (const vector<Point> &c : contours)
+             {
+                 Rect box = boundingRect(c);
+                 double peri = arcLength(c, true);
+                 doNotOptimize(box);
+                 doNotOptimize(peri);
+             }
+         }},
+        {"centroid", [&](int i) {
+             Point2f centre;
+             bool ok = selectPuck(input[i], centre);
+             doNotOptimize(ok);
+             doNotOptimize(centre);
+         }},
+        {"centroid/box", [&](int i) {
+             // Bounding box midpoint, what puckCentroid() replaced
+             const VisionBuffers &buf = input[i];
+             Point2f centre;
+             if (buf.blob_count > 0)
+             {
+                 const Rect &r = buf.blobs[0].box;
+                 centre = Point2f(r.x + r.width / 2.0f, r.y + r.height / 2.0f);
+             }
+             doNotOptimize(centre);
+         }},
+        {"findPuck", [&](int i) {
+             full.frame = input[i].frame; // Only read, so shared rather than copied
+             Point2f centre;
+             bool ok = findPuck(full, homography_matrix, centre);
+             doNotOptimize(ok);
+         }},
+        {"predict", [&](int i) {
+             PuckState puck = forwardPredict(pucks[i], 0.025f);
+             float x_pred = interceptX(puck, Y_MAX);
+             doNotOptimize(x_pred);
+         }},
+        {"strategy", [&](int i) {
+             int8_t cmd[4];
+             bool go = strategyCommand(strategy, 1, pucks[i], interceptX(pucks[i], Y_MAX), cmd);
+             doNotOptimize(go);
+             doNotOptimize(cmd);
+         }},
+        {"packet", [&](int i) {
+             int8_t packet[4] = {0, 0, 0, 0};
+             commandPacket(packet, i & 1, pucks[i].pos.x, pucks[i].pos.y);
+             doNotOptimize(packet);
+         }},
+    };
+
+    if (csv)
+    {
+        printf("benchmark,ns_per_frame,iterations\n");
+    }
+    else
+    {
+        printf("%d frames of %dx%d, puck found in %d, table %dx%d\n",
+               BENCH_FRAMES, FRM_COLS, FRM_ROWS, found, ROI_2.width, ROI_2.height);
+        printf("findBlobs matches findContours on %d masks\n", checked);
+        printf("%-20s %14s %12s\n", "Benchmark", "ns/frame", "Iterations");
+    }
+    for (const Benchmark &b : benchmarks)
+    {
+        if (strstr(b.name, filter) == NULL)
+        {
+            continue;
+        }
+        long iterations;
+        double ns = runBenchmark(b, min_time, iterations);
+        printf(csv ? "%s,%.1f,%ld\n" : "%-20s %14.1f %12ld\n", b.name, ns, iterations);
+    }
+    return 0;
+}